@@ -23,6 +23,8 @@ namespace blob {
  *   while (list->Next(id, key)) {
  *     std::cerr << id << " has " << key << std::endl;
  *   }
+ *   if (list->Failed())
+ *     std::cerr << "incomplete" << std::endl;
  * }
  */
 class Listing {
@@ -52,6 +54,10 @@ class Listing {
     virtual Status Prepare() noexcept = 0;
 
     virtual bool Next(std::string &id, std::string &key) noexcept = 0;
+
+    // Tells if a drive could not be listed to the end, so that Next() may
+    // have returned false before the last key
+    virtual bool Failed() const noexcept = 0;
 };
 
 } // namespace blob
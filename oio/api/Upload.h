@@ -49,6 +49,13 @@ class Upload {
 
     virtual void Write(const std::string &s) = 0;
 
+    // Room for at most `max` bytes of payload, `len` tells how many. The
+    // caller fills it in place then tells how much with Written(), before
+    // any other call. This spares the copy done by Write().
+    virtual uint8_t *Reserve(uint32_t max, uint32_t &len) = 0;
+
+    virtual void Written(uint32_t len) = 0;
+
     virtual void Flush() = 0;
 };
 
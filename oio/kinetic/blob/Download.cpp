@@ -4,23 +4,31 @@
  * v. 2.0. If a copy of the MPL was not distributed with this file, you can
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
-#include <queue>
+#include <algorithm>
 #include <functional>
-#include <forward_list>
 #include <glog/logging.h>
+#include <openssl/sha.h>
+#include <utils/MemoryBudget.h>
 #include <oio/kinetic/rpc/Get.h>
 #include <oio/kinetic/rpc/GetKeyRange.h>
 #include "oio/kinetic/client/ClientInterface.h"
 #include "Download.h"
 #include "Listing.h"
+#include "Manifest.h"
 
 using oio::kinetic::rpc::Get;
 using oio::kinetic::rpc::GetKeyRange;
 using oio::kinetic::client::ClientFactory;
 using oio::kinetic::client::ClientInterface;
 using oio::kinetic::client::Sync;
+using oio::kinetic::client::CompletionQueue;
 using oio::kinetic::blob::ListingBuilder;
 using oio::kinetic::blob::DownloadBuilder;
+using oio::kinetic::blob::Manifest;
+using oio::kinetic::blob::ChunkKey;
+using oio::kinetic::blob::ParseChunkKey;
+using oio::kinetic::blob::FetchManifest;
+namespace proto = ::com::seagate::kinetic::proto;
 
 struct PendingGet {
     uint32_t sequence;
@@ -28,13 +36,9 @@ struct PendingGet {
     std::shared_ptr<ClientInterface> client;
     Get op;
     std::shared_ptr<Sync> sync;
-    bool started;
-};
-
-struct PendingGetSorter {
-    bool cmp(const PendingGet &p0, const PendingGet &p1) const {
-        return p0.sequence < p1.sequence;
-    }
+    bool done;
+    bool verify; // the manifest gave the checksum
+    std::array<uint8_t, 20> sha1;
 };
 
 class Download : public oio::blob::Download {
@@ -44,7 +48,12 @@ class Download : public oio::blob::Download {
     Download(const std::string &n, std::shared_ptr<ClientFactory> f,
              std::vector<std::string> t) noexcept;
 
-    virtual ~Download() noexcept { }
+    virtual ~Download() noexcept {
+        // The exchanges in flight still point to their chunk
+        for (; running > 0; --running)
+            (void) cq->Wait();
+        MemoryBudget::Default().Release(window_bytes + handed_bytes);
+    }
 
     virtual oio::blob::Download::Status Prepare() noexcept;
 
@@ -52,25 +61,102 @@ class Download : public oio::blob::Download {
 
     virtual int32_t Read(std::vector<uint8_t> &buf) noexcept;
 
+  private:
+    // Starts as many chunks as the window allows
+    void fill() noexcept;
+
+    PendingGet *add_chunk(const std::string &key, uint32_t seq, uint32_t size,
+                          const std::string &target) noexcept;
+
+    oio::blob::Download::Status prepare_manifest(const Manifest &m) noexcept;
+
+    // For the blobs without a usable manifest
+    oio::blob::Download::Status prepare_listing() noexcept;
+
+    // Adds the next chunk given by the listing. Returns false at its end.
+    bool pull() noexcept;
+
   private:
     std::string chunkid;
     std::vector<std::string> targets;
     std::shared_ptr<ClientFactory> factory;
 
-    std::queue<PendingGet> running;
-    std::queue<PendingGet> waiting;
-    std::queue<PendingGet> done;
+    // Sorted by sequence. A chunk is freed once it has been read.
+    std::vector<std::unique_ptr<PendingGet>> chunks;
+
+    // With the ordered keys, the chunks not added yet
+    std::unique_ptr<oio::blob::Listing> listing;
+    std::shared_ptr<CompletionQueue> cq;
+    unsigned int next_start; // first chunk not started yet
+    unsigned int next_read; // first chunk not read yet
+    unsigned int running; // chunks started but not completed
+
+    // Bytes of the chunks started but not read yet. The chunks completed
+    // ahead of the one to be read are held up to this budget.
+    uint64_t window_bytes;
+
+    // Bytes of the last chunk read, still held by the caller
+    uint64_t handed_bytes;
 
     unsigned int parallel_factor;
+    uint64_t reorder_budget;
+    bool background;
+    bool failed; // a chunk could not be read
+    bool hole; // the listing lacks a chunk after the last one added
 };
 
 Download::Download(const std::string &n,
                    std::shared_ptr<ClientFactory> f,
                    std::vector<std::string> targets0) noexcept
-        : chunkid{n}, targets(), factory{f}, running(), waiting(), done(),
-          parallel_factor{4} { targets.swap(targets0); }
+        : chunkid{n}, targets(), factory{f}, chunks(), listing(),
+          cq(new CompletionQueue), next_start{0}, next_read{0}, running{0},
+          window_bytes{0}, handed_bytes{0}, parallel_factor{4}, reorder_budget{8 * 1024 * 1024},
+          background{false}, failed{false}, hole{false} {
+    targets.swap(targets0);
+}
+
+PendingGet *Download::add_chunk(const std::string &key, uint32_t seq,
+                                uint32_t size,
+                                const std::string &target) noexcept {
+    PendingGet *pg = new PendingGet;
+    pg->op.Key(key);
+    // A client waits for the data, unless it is a batch
+    pg->op.SetPriority(background ? proto::Command_Priority_LOWER
+                                  : proto::Command_Priority_HIGHER);
+    pg->size = size;
+    pg->sequence = seq;
+    pg->client = factory->Get(target);
+    pg->done = false;
+    pg->verify = false;
+    DLOG(INFO) << "Chunk [" << key << "] seq=" << pg->sequence <<
+    " size=" << pg->size;
+    chunks.emplace_back(pg);
+    return pg;
+}
 
 oio::blob::Download::Status Download::Prepare() noexcept {
+    // A single GET when the manifest lists the chunks
+    Manifest manifest;
+    if (FetchManifest(*factory, chunkid, targets, manifest))
+        return prepare_manifest(manifest);
+    return prepare_listing();
+}
+
+oio::blob::Download::Status Download::prepare_manifest(
+        const Manifest &m) noexcept {
+    for (unsigned int i = 0; i < m.chunks.size(); ++i) {
+        const auto &c = m.chunks[i];
+        const auto key = ChunkKey(chunkid, i, c.size, m.ordered_keys);
+        auto pg = add_chunk(key, i, c.size, c.target);
+        pg->verify = true;
+        pg->sha1 = c.sha1;
+        if (pg->client->IsDown())
+            return oio::blob::Download::Status::NetworkError;
+    }
+    return oio::blob::Download::Status::OK;
+}
+
+oio::blob::Download::Status Download::prepare_listing() noexcept {
 
     // List the chunks
     ListingBuilder builder(factory);
@@ -78,7 +164,7 @@ oio::blob::Download::Status Download::Prepare() noexcept {
     for (const auto &to: targets)
         builder.Target(to);
 
-    auto listing = builder.Build();
+    listing = builder.Build();
     switch (listing->Prepare()) {
         case oio::blob::Listing::Status::OK:
             break;
@@ -90,80 +176,153 @@ oio::blob::Download::Status Download::Prepare() noexcept {
             return oio::blob::Download::Status::ProtocolError;
     }
 
+    // The ordered keys come in the order of the chunks: the download starts
+    // with the first one, the others are added while reading.
     std::string id, key;
-    std::forward_list<PendingGet> chunks;
     while (listing->Next(id, key)) {
-        std::string k(key);
-        auto dash = k.rfind('-');
-        if (dash == std::string::npos) {
-            // malformed
-            DLOG(INFO) << "Malformed [" << k << "]";
-        } else if (k[dash + 1] == '#') {
-            // Manifest
-            DLOG(INFO) << "Manifest [" << key << "]";
-        } else {
-            int size = std::stoi(k.substr(dash + 1));
-            k.resize(dash);
-            dash = k.rfind('-');
-            if (dash == std::string::npos) {
-                // malformed
-                DLOG(INFO) << "Malformed [" << k << "]";
-            } else {
-                int seq = std::stoi(k.substr(dash + 1));
-                k.resize(dash);
-                PendingGet pg;
-                pg.op.Key(key);
-                pg.size = size;
-                pg.sequence = seq;
-                pg.client = factory->Get(id);
-                DLOG(INFO) << "Chunk [" << key << "] seq=" << pg.sequence <<
-                " size=" << pg.size;
-                chunks.push_front(pg);
-            }
+        uint32_t seq, size;
+        bool ordered;
+        if (!ParseChunkKey(key, seq, size, ordered)) {
+            DLOG(INFO) << "Not a chunk [" << key << "]";
+            continue;
+        }
+        if (ordered && chunks.empty()) {
+            if (seq != 0)
+                return oio::blob::Download::Status::NetworkError;
+            (void) add_chunk(key, seq, size, id);
+            return oio::blob::Download::Status::OK;
         }
+        (void) add_chunk(key, seq, size, id);
+    }
+    const bool incomplete = listing->Failed();
+    listing.reset();
+    if (incomplete)
+        return oio::blob::Download::Status::NetworkError;
+
+    // The legacy keys sort as strings, e.g. 10 before 2
+    std::sort(chunks.begin(), chunks.end(),
+              [](const std::unique_ptr<PendingGet> &p0,
+                 const std::unique_ptr<PendingGet> &p1) -> bool {
+                  return p0->sequence < p1->sequence;
+              });
+
+    // A hole in the sequence means a chunk is on a drive that is down
+    for (unsigned int i = 0; i < chunks.size(); ++i) {
+        if (chunks[i]->sequence != i)
+            return oio::blob::Download::Status::NetworkError;
     }
-    chunks.sort([](const PendingGet &p0, const PendingGet &p1) -> bool {
-        return p0.sequence < p1.sequence;
-    });
-
-    for (auto p: chunks)
-        waiting.push(p);
 
     return oio::blob::Download::Status::OK;
 }
 
+bool Download::pull() noexcept {
+    std::string id, key;
+    while (listing->Next(id, key)) {
+        uint32_t seq, size;
+        bool ordered;
+        if (!ParseChunkKey(key, seq, size, ordered)) {
+            DLOG(INFO) << "Not a chunk [" << key << "]";
+            continue;
+        }
+        if (seq != chunks.size()) {
+            // On a drive that is down, or not written
+            hole = true;
+            break;
+        }
+        (void) add_chunk(key, seq, size, id);
+        return true;
+    }
+    // The next chunks may be on a drive that failed
+    if (listing->Failed())
+        hole = true;
+    listing.reset();
+    return false;
+}
+
 bool Download::IsEof() noexcept {
-    return waiting.empty() && running.empty();
+    // Tell the end only once the listing has nothing more
+    if (!failed && next_read >= chunks.size() && listing)
+        (void) pull();
+    return failed || (next_read >= chunks.size() && !hole);
 }
 
-int32_t Download::Read(std::vector<uint8_t> &buf) noexcept {
-    DLOG(INFO) << "Currently " << running.size() <<
-    " chunks downbloads running";
-    while (running.size() < parallel_factor) {
-        if (waiting.empty()) {
-            DLOG(INFO) << "No chunks in the waiting queue";
+void Download::fill() noexcept {
+    while (running < parallel_factor
+           && (next_start < chunks.size() || (listing && pull()))) {
+        auto &pg = chunks[next_start];
+        // The chunk to be read always starts, whatever the budget
+        if (next_start > next_read
+            && window_bytes + pg->size > reorder_budget)
             break;
-        } else {
-            auto pg = waiting.front();
-            pg.sync = pg.client->Start(&pg.op);
-            running.push(pg);
-            waiting.pop();
-            DLOG(INFO) << "chunk download started";
-        }
+        // Only the chunk to be read may wait for the memory: nothing else
+        // is held then. The others are started when memory is available.
+        if (next_start == next_read)
+            (void) MemoryBudget::Default().Acquire(pg->size, -1);
+        else if (!MemoryBudget::Default().TryAcquire(pg->size))
+            break;
+        pg->sync = pg->client->Start(&pg->op, cq, next_start);
+        window_bytes += pg->size;
+        ++running;
+        ++next_start;
+        DLOG(INFO) << "chunk download started";
     }
+}
 
-    if (running.empty())
+int32_t Download::Read(std::vector<uint8_t> &buf) noexcept {
+    DLOG(INFO) << "Currently " << running <<
+    " chunks downbloads running";
+    if (IsEof())
         return 0;
+    if (next_read >= chunks.size()) {
+        LOG(ERROR) << "Chunk " << next_read << " of " << chunkid << " missing";
+        failed = true;
+        buf.clear();
+        return -1;
+    }
+
+    // The caller is done with the previous chunk
+    MemoryBudget::Default().Release(handed_bytes);
+    handed_bytes = 0;
+
+    // Consume the completions until the next chunk is there, keeping
+    // the window full with the chunks that follow.
+    fill();
+    auto &head = chunks[next_read];
+    while (!head->done) {
+        const auto tag = cq->Wait();
+        chunks[tag]->done = true;
+        --running;
+        fill();
+    }
 
-    auto pg = running.front();
-    running.pop();
-    pg.sync->Wait();
-    pg.op.Steal(buf);
+    head->op.Steal(buf);
+    window_bytes -= head->size;
+    handed_bytes = head->size;
+    if (!head->op.Ok()) {
+        LOG(ERROR) << "Chunk " << head->sequence << " of " << chunkid
+                   << " unreadable";
+        failed = true;
+    } else if (head->verify) {
+        std::array<uint8_t, 20> sha1;
+        ::SHA1(buf.data(), buf.size(), sha1.data());
+        if (sha1 != head->sha1) {
+            LOG(ERROR) << "Chunk " << head->sequence << " of " << chunkid
+                       << " corrupted";
+            failed = true;
+        }
+    }
+    head.reset();
+    ++next_read;
+    if (failed) {
+        buf.clear();
+        return -1;
+    }
+    fill();
     return buf.size();
 }
 
 DownloadBuilder::DownloadBuilder(std::shared_ptr<ClientFactory> f) noexcept:
-        name(), targets(), factory(f) { }
+        name(), targets(), factory(f), background{false} { }
 
 DownloadBuilder::~DownloadBuilder() { }
 
@@ -185,6 +344,10 @@ void DownloadBuilder::Target(const char *to) noexcept {
     return Target(std::string(to));
 }
 
+void DownloadBuilder::Background(bool b) noexcept {
+    background = b;
+}
+
 std::unique_ptr<oio::blob::Download> DownloadBuilder::Build() noexcept {
     assert(!targets.empty());
     assert(!name.empty());
@@ -192,5 +355,7 @@ std::unique_ptr<oio::blob::Download> DownloadBuilder::Build() noexcept {
     std::vector<std::string> v;
     for (const auto &t: targets)
         v.emplace_back(t);
-    return std::unique_ptr<Download>(new Download(name, factory, std::move(v)));
+    auto dl = new Download(name, factory, std::move(v));
+    dl->background = background;
+    return std::unique_ptr<Download>(dl);
 }
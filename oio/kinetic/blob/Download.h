@@ -31,12 +31,16 @@ class DownloadBuilder {
 
     void Target(const std::string &to) noexcept;
 
+    // The chunks yield to the other exchanges on the drives
+    void Background(bool b) noexcept;
+
     std::unique_ptr<oio::blob::Download> Build() noexcept;
 
   private:
     std::string name;
     std::set<std::string> targets;
     std::shared_ptr<oio::kinetic::client::ClientFactory> factory;
+    bool background;
 };
 
 } // namespace client
@@ -4,10 +4,14 @@
  * v. 2.0. If a copy of the MPL was not distributed with this file, you can
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
+#include <algorithm>
+#include <cassert>
+#include <deque>
 #include <string>
 #include <glog/logging.h>
 #include <oio/api/Listing.h>
 #include <oio/kinetic/client/ClientInterface.h>
+#include <oio/kinetic/client/Batch.h>
 #include <oio/kinetic/rpc/GetKeyRange.h>
 #include "Listing.h"
 
@@ -15,79 +19,226 @@ using oio::kinetic::blob::ListingBuilder;
 using oio::kinetic::client::ClientInterface;
 using oio::kinetic::client::ClientFactory;
 using oio::kinetic::client::Sync;
+using oio::kinetic::client::Batch;
 using oio::kinetic::rpc::GetKeyRange;
 
+// The keys of one drive, a page at a time, the next page being fetched
+// while the current one is consumed
+struct Cursor {
+    unsigned int client;
+    std::vector<std::string> keys;
+    size_t pos;
+    std::vector<std::string> ahead;
+    std::string last;
+    std::unique_ptr<GetKeyRange> op;
+    std::shared_ptr<Sync> sync;
+    bool queued, received, exhausted;
+
+    Cursor(unsigned int c) noexcept:
+            client{c}, keys(), pos{0}, ahead(), last(), op(), sync(),
+            queued{false}, received{false}, exhausted{false} { }
+
+    bool Empty() const noexcept { return pos >= keys.size(); }
+
+    const std::string &Head() const noexcept { return keys[pos]; }
+};
+
 class Listing : public oio::blob::Listing {
     friend class ListingBuilder;
 
   public:
     Listing() noexcept;
 
-    ~Listing() noexcept { }
+    ~Listing() noexcept;
 
     oio::blob::Listing::Status Prepare() noexcept;
 
     bool Next(std::string &id, std::string &dst) noexcept;
 
+    bool Failed() const noexcept { return failures > 0; }
+
   private:
-    void lazy_init() noexcept;
+    // Asks for the next page of the cursor, or queues it when too many
+    // drives are already being asked
+    void request(unsigned int c) noexcept;
+
+    void start(unsigned int c) noexcept;
+
+    // Waits for the page in flight of the cursor
+    void collect(unsigned int c) noexcept;
+
+    // Refills the cursor once its page is consumed. Returns false when the
+    // drive has nothing more.
+    bool ensure(unsigned int c) noexcept;
 
   private:
     std::vector<std::shared_ptr<ClientInterface>> clients;
     std::string name;
+    int32_t page_size;
+    unsigned int parallelism;
 
-    std::vector<std::pair<int, std::string>> items;
-    unsigned int next_item;
+    std::vector<Cursor> cursors;
+    std::deque<unsigned int> queued;
+    std::deque<unsigned int> inflight; // the order of the starts
+    unsigned int failures;
+
+    // The cursors with a key, the smallest head on top
+    std::vector<unsigned int> heap;
 };
 
 Listing::Listing() noexcept
-        : clients(), name(), items(), next_item{0} { }
+        : clients(), name(), page_size{200}, parallelism{8}, cursors(),
+          queued(), inflight(), failures{0}, heap() { }
+
+Listing::~Listing() noexcept {
+    // The pages in flight are still referenced by their client
+    queued.clear();
+    while (!inflight.empty())
+        collect(inflight.front());
+}
+
+void Listing::request(unsigned int c) noexcept {
+    if (inflight.size() < parallelism) {
+        start(c);
+    } else {
+        cursors[c].queued = true;
+        queued.push_back(c);
+    }
+}
+
+void Listing::start(unsigned int c) noexcept {
+    auto &cur = cursors[c];
+    cur.queued = false;
+    cur.op.reset(new GetKeyRange);
+    if (cur.last.empty()) {
+        cur.op->Start(name + "-#");
+        cur.op->IncludeStart(true);
+    } else {
+        cur.op->Start(cur.last);
+        cur.op->IncludeStart(false);
+    }
+    cur.op->End(name + "-X");
+    cur.op->IncludeEnd(false);
+    cur.op->MaxItems(page_size);
+    cur.sync = clients[cur.client]->Start(cur.op.get());
+    inflight.push_back(c);
+}
+
+void Listing::collect(unsigned int c) noexcept {
+    auto &cur = cursors[c];
+    cur.sync->Wait();
+    inflight.erase(std::find(inflight.begin(), inflight.end(), c));
+
+    cur.received = true;
+    if (!cur.op->Ok()) {
+        LOG(WARNING) << "Listing of " << name << " interrupted on "
+                     << clients[cur.client]->Id();
+        ++failures;
+        cur.exhausted = true;
+    } else {
+        cur.op->Steal(cur.ahead);
+        // A drive may return fewer keys than asked: only an empty page
+        // tells the end
+        if (cur.ahead.empty())
+            cur.exhausted = true;
+        else
+            cur.last = cur.ahead.back();
+    }
+    cur.op.reset();
+    cur.sync.reset();
+
+    while (!queued.empty() && inflight.size() < parallelism) {
+        const auto next = queued.front();
+        queued.pop_front();
+        start(next);
+    }
+}
+
+bool Listing::ensure(unsigned int c) noexcept {
+    auto &cur = cursors[c];
+    while (cur.Empty()) {
+        if (!cur.ahead.empty()) {
+            cur.keys.clear();
+            cur.keys.swap(cur.ahead);
+            cur.pos = 0;
+            // Prefetch while the caller consumes this page
+            if (!cur.exhausted)
+                request(c);
+        } else if (cur.sync) {
+            collect(c);
+        } else if (cur.queued) {
+            // Make room: the oldest page in flight is needed soon anyway
+            collect(inflight.front());
+        } else if (cur.exhausted) {
+            return false;
+        } else {
+            request(c);
+        }
+    }
+    return true;
+}
+
+static bool _later(const std::vector<Cursor> &cursors,
+                   unsigned int c0, unsigned int c1) noexcept {
+    return cursors[c0].Head() > cursors[c1].Head();
+}
 
 bool Listing::Next(std::string &id, std::string &key) noexcept {
-    if (next_item >= items.size())
+    if (heap.empty())
         return false;
 
-    const auto &item = items[next_item++];
-    id.assign(clients[std::get<0>(item)]->Id());
-    key.assign(std::get<1>(item));
+    auto later = [this](unsigned int c0, unsigned int c1) -> bool {
+        return _later(cursors, c0, c1);
+    };
+    std::pop_heap(heap.begin(), heap.end(), later);
+    const auto c = heap.back();
+    heap.pop_back();
+
+    auto &cur = cursors[c];
+    id.assign(clients[cur.client]->Id());
+    key.swap(cur.keys[cur.pos++]);
+
+    if (ensure(c)) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
     return true;
 }
 
-// Concurrently get the lists on each node
-// TODO limit the parallelism to N (configurable) items
+// Merges the sorted lists of the drives as they are consumed. At most
+// `parallelism` drives are asked at once.
 oio::blob::Listing::Status Listing::Prepare() noexcept {
 
-    items.clear();
-    std::vector<std::shared_ptr<GetKeyRange>> ops;
-    std::vector<std::shared_ptr<Sync>> syncs;
-
-    for (auto cli: clients) {
-        auto gkr = new GetKeyRange;
-        gkr->Start(name + "-#");
-        gkr->End(name + "-X");
-        gkr->IncludeStart(true);
-        gkr->IncludeEnd(false);
-        ops.emplace_back(gkr);
-        syncs.emplace_back(cli->Start(gkr));
-    }
-    for (auto sync: syncs)
-        sync->Wait();
-
-    for (unsigned int i = 0; i < ops.size(); ++i) {
-        std::vector<std::string> keys;
-        ops[i]->Steal(keys);
-        for (auto &k: keys) {
-            // We try here to avoid copies
-            std::string s;
-            s.swap(k);
-            items.emplace_back(i, std::move(s));
-            assert(s.size() == 0);
-            assert(k.size() == 0);
+    cursors.clear();
+    heap.clear();
+    failures = 0;
+    unsigned int skipped = 0;
+
+    for (unsigned int i = 0; i < clients.size(); ++i) {
+        // Don't wait for a drive known to be down
+        if (clients[i]->IsDown()) {
+            DLOG(INFO) << "Listing skips " << clients[i]->Id();
+            ++skipped;
+            continue;
         }
+        cursors.emplace_back(i);
+    }
+    for (unsigned int c = 0; c < cursors.size(); ++c)
+        request(c);
+
+    for (unsigned int c = 0; c < cursors.size(); ++c) {
+        if (ensure(c))
+            heap.push_back(c);
     }
+    std::make_heap(heap.begin(), heap.end(),
+                   [this](unsigned int c0, unsigned int c1) -> bool {
+                       return _later(cursors, c0, c1);
+                   });
 
-    if (items.empty())
-        return oio::blob::Listing::Status::NotFound;
+    if (heap.empty())
+        return skipped + failures > 0
+               ? oio::blob::Listing::Status::NetworkError
+               : oio::blob::Listing::Status::NotFound;
 
     return oio::blob::Listing::Status::OK;
 }
@@ -95,7 +246,7 @@ oio::blob::Listing::Status Listing::Prepare() noexcept {
 ListingBuilder::~ListingBuilder() { }
 
 ListingBuilder::ListingBuilder(std::shared_ptr<ClientFactory> f) noexcept
-        : factory(f), targets(), name() { }
+        : factory(f), targets(), name(), page_size{200}, parallelism{8} { }
 
 void ListingBuilder::Name(const std::string &n) noexcept {
     name.assign(n);
@@ -115,12 +266,24 @@ void ListingBuilder::Target(const char *to) noexcept {
     return Target(std::string(to));
 }
 
+void ListingBuilder::PageSize(int32_t n) noexcept {
+    assert(n > 0);
+    page_size = n;
+}
+
+void ListingBuilder::Parallelism(unsigned int n) noexcept {
+    assert(n > 0);
+    parallelism = n;
+}
+
 std::unique_ptr<oio::blob::Listing> ListingBuilder::Build() noexcept {
     assert(!targets.empty());
     assert(!name.empty());
 
     auto listing = new Listing;
     listing->name.assign(name);
+    listing->page_size = page_size;
+    listing->parallelism = parallelism;
     for (auto to: targets)
         listing->clients.emplace_back(factory->Get(to));
     return std::unique_ptr<Listing>(listing);
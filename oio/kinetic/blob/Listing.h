@@ -7,6 +7,7 @@
 #ifndef OIO_KINETIC_CLIENT_LISTING_H
 #define OIO_KINETIC_CLIENT_LISTING_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <set>
@@ -31,12 +32,20 @@ class ListingBuilder {
 
     void Target(const char *to) noexcept;
 
+    // Keys asked to a drive at once
+    void PageSize(int32_t n) noexcept;
+
+    // Drives asked at once
+    void Parallelism(unsigned int n) noexcept;
+
     std::unique_ptr<oio::blob::Listing> Build() noexcept;
 
   private:
     std::shared_ptr<oio::kinetic::client::ClientFactory> factory;
     std::set<std::string> targets;
     std::string name;
+    int32_t page_size;
+    unsigned int parallelism;
 };
 
 } // namespace client
@@ -0,0 +1,268 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <glog/logging.h>
+#include <oio/kinetic/rpc/Get.h>
+#include "Manifest.h"
+
+using oio::kinetic::blob::Manifest;
+using oio::kinetic::blob::ManifestChunk;
+using oio::kinetic::client::ClientFactory;
+using oio::kinetic::rpc::Get;
+namespace proto = ::com::seagate::kinetic::proto;
+
+static const uint8_t magic[4] = {'O', 'I', 'O', 'M'};
+
+static constexpr uint8_t flag_chunks_omitted = 0x01;
+static constexpr uint8_t flag_ordered_keys = 0x02;
+
+// The integers are big endian, the strings prefixed by their length
+static void _put(std::vector<uint8_t> &out, uint64_t v, unsigned int width) {
+    for (unsigned int i = width; i > 0; --i)
+        out.push_back(static_cast<uint8_t>(v >> (8 * (i - 1))));
+}
+
+static void _put(std::vector<uint8_t> &out, const std::string &s,
+                 unsigned int width) {
+    _put(out, s.size(), width);
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+namespace {
+struct Reader {
+    const std::vector<uint8_t> &buf;
+    size_t pos;
+    bool ok;
+
+    bool get(uint64_t &v, unsigned int width) noexcept {
+        if (!ok || buf.size() - pos < width)
+            return ok = false;
+        v = 0;
+        for (unsigned int i = 0; i < width; ++i)
+            v = (v << 8) | buf[pos++];
+        return true;
+    }
+
+    bool get(std::string &s, unsigned int width) noexcept {
+        uint64_t len;
+        if (!get(len, width) || buf.size() - pos < len)
+            return ok = false;
+        s.assign(reinterpret_cast<const char *>(buf.data() + pos), len);
+        pos += len;
+        return true;
+    }
+};
+}
+
+void Manifest::Encode(std::vector<uint8_t> &out) const noexcept {
+    // The chunks only refer to their target in a table
+    std::vector<std::string> targets;
+    std::map<std::string, unsigned int> index;
+    for (const auto &c: chunks) {
+        if (index.emplace(c.target, targets.size()).second)
+            targets.push_back(c.target);
+    }
+
+    out.clear();
+    out.insert(out.end(), magic, magic + sizeof(magic));
+    _put(out, version, 1);
+    _put(out, (chunks_omitted ? flag_chunks_omitted : 0)
+              | (ordered_keys ? flag_ordered_keys : 0), 1);
+    _put(out, total_size, 8);
+    _put(out, targets.size(), 2);
+    for (const auto &t: targets)
+        _put(out, t, 2);
+    _put(out, chunks.size(), 4);
+    for (const auto &c: chunks) {
+        _put(out, index[c.target], 2);
+        _put(out, c.size, 4);
+        out.insert(out.end(), c.sha1.begin(), c.sha1.end());
+    }
+    _put(out, xattr.size(), 4);
+    for (const auto &e: xattr) {
+        _put(out, e.first, 2);
+        _put(out, e.second, 4);
+    }
+}
+
+bool Manifest::Decode(const std::vector<uint8_t> &buf) noexcept {
+    if (buf.size() < sizeof(magic) || 0 != ::memcmp(buf.data(), magic, sizeof(magic)))
+        return false;
+    Reader r{buf, sizeof(magic), true};
+    uint64_t v, flags, nb;
+    if (!r.get(v, 1) || v != version || !r.get(flags, 1))
+        return false;
+    chunks_omitted = 0 != (flags & flag_chunks_omitted);
+    ordered_keys = 0 != (flags & flag_ordered_keys);
+    if (!r.get(total_size, 8))
+        return false;
+
+    std::vector<std::string> targets;
+    if (!r.get(nb, 2))
+        return false;
+    targets.resize(nb);
+    for (auto &t: targets) {
+        if (!r.get(t, 2))
+            return false;
+    }
+
+    chunks.clear();
+    if (!r.get(nb, 4) || nb > buf.size())
+        return false;
+    chunks.resize(nb);
+    for (auto &c: chunks) {
+        uint64_t idx, size;
+        if (!r.get(idx, 2) || idx >= targets.size() || !r.get(size, 4)
+            || buf.size() - r.pos < c.sha1.size())
+            return false;
+        c.target = targets[idx];
+        c.size = size;
+        ::memcpy(c.sha1.data(), buf.data() + r.pos, c.sha1.size());
+        r.pos += c.sha1.size();
+    }
+
+    xattr.clear();
+    if (!r.get(nb, 4))
+        return false;
+    for (; nb > 0; --nb) {
+        std::string k, val;
+        if (!r.get(k, 2) || !r.get(val, 4))
+            return false;
+        xattr[k] = std::move(val);
+    }
+    return r.ok;
+}
+
+std::string oio::kinetic::blob::ManifestKey(const std::string &chunkid) noexcept {
+    return chunkid + "-#";
+}
+
+// The ordered keys end with "-=SSSSSSSS-ZZZZZZZZ" in hexadecimal. '=' sorts
+// after the digits of the legacy keys and within the range listed.
+static constexpr size_t ordered_suffix = 19;
+
+std::string oio::kinetic::blob::ChunkKey(const std::string &chunkid,
+                                         uint32_t seq, uint32_t size,
+                                         bool ordered) noexcept {
+    if (ordered) {
+        char suffix[ordered_suffix + 1];
+        ::snprintf(suffix, sizeof(suffix), "-=%08x-%08x", seq, size);
+        return chunkid + suffix;
+    }
+    std::stringstream ss;
+    ss << chunkid << '-' << seq << '-' << size;
+    return ss.str();
+}
+
+static bool _parse(const char *s, size_t len, int base, uint32_t &out) {
+    if (len == 0 || len > 10)
+        return false;
+    for (size_t i = 0; i < len; ++i) {
+        if (base == 16 ? !::isxdigit(s[i]) : !::isdigit(s[i]))
+            return false;
+    }
+    const auto v = ::strtoull(std::string(s, len).c_str(), nullptr, base);
+    if (v > UINT32_MAX)
+        return false;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+bool oio::kinetic::blob::ParseChunkKey(const std::string &key, uint32_t &seq,
+                                       uint32_t &size, bool &ordered) noexcept {
+    const auto len = key.size();
+    if (len > ordered_suffix && key[len - 19] == '-' && key[len - 18] == '='
+        && key[len - 9] == '-') {
+        ordered = true;
+        return _parse(key.data() + len - 17, 8, 16, seq)
+               && _parse(key.data() + len - 8, 8, 16, size);
+    }
+
+    ordered = false;
+    const auto dash_size = key.rfind('-');
+    if (dash_size == std::string::npos || dash_size == 0)
+        return false;
+    // Behind a chunk id, never empty
+    const auto dash_seq = key.rfind('-', dash_size - 1);
+    if (dash_seq == std::string::npos || dash_seq == 0)
+        return false;
+    return _parse(key.data() + dash_seq + 1, dash_size - dash_seq - 1, 10, seq)
+           && _parse(key.data() + dash_size + 1, len - dash_size - 1, 10, size);
+}
+
+// FNV-1a, stable across the builds unlike std::hash, with a final mix so
+// that the close inputs give distant scores
+static uint64_t _score(const std::string &chunkid,
+                       const std::string &target) noexcept {
+    uint64_t h = 14695981039346656037ULL;
+    auto mix = [&h](uint8_t c) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    };
+    for (auto c: chunkid)
+        mix(c);
+    mix(0);
+    for (auto c: target)
+        mix(c);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+std::vector<unsigned int> oio::kinetic::blob::ManifestTargets(
+        const std::string &chunkid, const std::vector<std::string> &targets,
+        unsigned int replicas) noexcept {
+    std::vector<std::pair<uint64_t, unsigned int>> scores;
+    for (unsigned int i = 0; i < targets.size(); ++i)
+        scores.emplace_back(_score(chunkid, targets[i]), i);
+    std::sort(scores.begin(), scores.end(),
+              [](const std::pair<uint64_t, unsigned int> &s0,
+                 const std::pair<uint64_t, unsigned int> &s1) -> bool {
+                  return s0.first > s1.first;
+              });
+
+    std::vector<unsigned int> out;
+    for (unsigned int i = 0; i < scores.size() && i < replicas; ++i)
+        out.push_back(scores[i].second);
+    return out;
+}
+
+bool oio::kinetic::blob::FetchManifest(ClientFactory &factory,
+                                       const std::string &chunkid,
+                                       const std::vector<std::string> &targets,
+                                       Manifest &manifest) noexcept {
+    for (auto idx: ManifestTargets(chunkid, targets)) {
+        auto client = factory.Get(targets[idx]);
+        if (client->IsDown())
+            continue;
+
+        Get get;
+        get.Key(ManifestKey(chunkid));
+        get.SetPriority(proto::Command_Priority_HIGHER);
+        client->Start(&get)->Wait();
+        if (!get.Ok())
+            continue;
+
+        std::vector<uint8_t> value;
+        get.Steal(value);
+        if (!manifest.Decode(value)) {
+            // Written before the binary manifests
+            DLOG(INFO) << "Manifest of " << chunkid << " not decoded";
+            return false;
+        }
+        return !manifest.chunks_omitted;
+    }
+    return false;
+}
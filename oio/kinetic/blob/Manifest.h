@@ -0,0 +1,84 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_BLOB_MANIFEST_H
+#define OIO_KINETIC_BLOB_MANIFEST_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <oio/kinetic/client/ClientInterface.h>
+
+namespace oio {
+namespace kinetic {
+namespace blob {
+
+struct ManifestChunk {
+    std::string target;
+    uint32_t size;
+    std::array<uint8_t, 20> sha1;
+};
+
+/* Describes a blob: its chunks in their order, where they are, and the
+ * xattr. It is written last by the upload, under ManifestKey(), on each of
+ * the ManifestTargets(). When the chunks don't fit in a value, they are
+ * omitted, and the readers list the drives instead. */
+struct Manifest {
+    static constexpr uint8_t version = 1;
+
+    uint64_t total_size;
+    bool chunks_omitted;
+    bool ordered_keys; // the chunks are under keys of the ordered format
+    std::vector<ManifestChunk> chunks;
+    std::map<std::string, std::string> xattr;
+
+    Manifest() noexcept: total_size{0}, chunks_omitted{false},
+                         ordered_keys{true}, chunks(), xattr() { }
+
+    void Encode(std::vector<uint8_t> &out) const noexcept;
+
+    // Returns false if `buf` isn't a manifest of a known version
+    bool Decode(const std::vector<uint8_t> &buf) noexcept;
+};
+
+std::string ManifestKey(const std::string &chunkid) noexcept;
+
+// With `ordered`, the sequence and the size have a fixed width, so that the
+// keys of a blob sort in the order of its chunks. Else, the legacy format,
+// in decimal.
+std::string ChunkKey(const std::string &chunkid, uint32_t seq, uint32_t size,
+                     bool ordered = true) noexcept;
+
+// Reads a chunk key of either format. Returns false for the manifest key
+// or a malformed key.
+bool ParseChunkKey(const std::string &key, uint32_t &seq, uint32_t &size,
+                   bool &ordered) noexcept;
+
+static constexpr unsigned int manifest_replicas = 2;
+
+// Indexes of the targets holding the manifest of `chunkid`, the preferred
+// first. With a rendezvous hashing, the order of the targets doesn't
+// matter, and a target added or removed only moves the manifests it holds.
+std::vector<unsigned int> ManifestTargets(
+        const std::string &chunkid, const std::vector<std::string> &targets,
+        unsigned int replicas = manifest_replicas) noexcept;
+
+// Reads the manifest of `chunkid` on the first of its drives that has it.
+// Returns false if none has it or it is not usable, then the caller lists
+// the drives.
+bool FetchManifest(oio::kinetic::client::ClientFactory &factory,
+                   const std::string &chunkid,
+                   const std::vector<std::string> &targets,
+                   Manifest &manifest) noexcept;
+
+} // namespace blob
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_BLOB_MANIFEST_H
@@ -4,18 +4,28 @@
  * v. 2.0. If a copy of the MPL was not distributed with this file, you can
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
+#include <algorithm>
 #include <cassert>
 #include <queue>
 #include <glog/logging.h>
 #include <oio/kinetic/rpc/Delete.h>
+#include <oio/kinetic/client/Batch.h>
 #include "Listing.h"
+#include "Manifest.h"
 #include "Removal.h"
 
 using oio::kinetic::client::Sync;
+using oio::kinetic::client::Batch;
 using oio::kinetic::client::ClientInterface;
 using oio::kinetic::client::ClientFactory;
 using oio::kinetic::blob::RemovalBuilder;
 using oio::kinetic::blob::ListingBuilder;
+using oio::kinetic::blob::Manifest;
+using oio::kinetic::blob::ChunkKey;
+using oio::kinetic::blob::ManifestKey;
+using oio::kinetic::blob::ManifestTargets;
+using oio::kinetic::blob::FetchManifest;
+namespace proto = ::com::seagate::kinetic::proto;
 
 struct PendingDelete {
     std::string k;
@@ -23,6 +33,9 @@ struct PendingDelete {
     std::shared_ptr<oio::kinetic::client::ClientInterface> client;
     std::shared_ptr<Sync> sync;
 
+    // A key already absent is as good as deleted
+    bool Done() const noexcept { return op.Ok() || op.NotFound(); }
+
     void Start() {
         assert(sync.get() == nullptr);
         sync = client->Start(&op);
@@ -49,6 +62,9 @@ class Removal : public oio::blob::Removal {
 
     virtual bool Ok() noexcept;
 
+  private:
+    void add(const std::string &key, const std::string &target) noexcept;
+
   private:
     unsigned int parallelism_factor;
     std::string chunkid;
@@ -58,7 +74,31 @@ class Removal : public oio::blob::Removal {
     std::vector<PendingDelete> ops;
 };
 
+void Removal::add(const std::string &key, const std::string &target) noexcept {
+    PendingDelete del;
+    del.k.assign(key);
+    del.op.Key(key);
+    // Nobody waits for the space to be freed
+    del.op.SetPriority(proto::Command_Priority_LOWER);
+    del.client = factory->Get(target);
+    DLOG(INFO) << "rem("<< target << ","<< key <<")";
+    ops.push_back(del);
+}
+
 oio::blob::Removal::Status Removal::Prepare() noexcept {
+    // The manifest goes first, Commit() deletes it before the chunks so that
+    // the blob disappears at once. The listing also gives it first.
+    Manifest manifest;
+    if (FetchManifest(*factory, chunkid, targets, manifest)) {
+        for (auto idx: ManifestTargets(chunkid, targets))
+            add(ManifestKey(chunkid), targets[idx]);
+        for (unsigned int i = 0; i < manifest.chunks.size(); ++i) {
+            const auto &c = manifest.chunks[i];
+            add(ChunkKey(chunkid, i, c.size, manifest.ordered_keys), c.target);
+        }
+        return oio::blob::Removal::Status::OK;
+    }
+
     ListingBuilder builder(factory);
     builder.Name(chunkid);
     for (const auto &to: targets)
@@ -78,32 +118,58 @@ oio::blob::Removal::Status Removal::Prepare() noexcept {
     }
 
     std::string id, key;
-    while (listing->Next(id, key)) {
-        PendingDelete del;
-        del.k.assign(key);
-        del.op.Key(key);
-        del.client = factory->Get(id);
-        DLOG(INFO) << "rem("<< id << ","<< key <<")";
-        ops.push_back(del);
-    }
+    while (listing->Next(id, key))
+        add(key, id);
+    // Chunks would be left behind
+    if (listing->Failed())
+        return oio::blob::Removal::Status::NetworkError;
 
     return oio::blob::Removal::Status::OK;
 }
 
 bool Removal::Commit() noexcept {
     DLOG(INFO) << __FUNCTION__ << " of " << ops.size() << " ops";
-    // Pre-start as many parallel operations as the configured parallelism
-    for (unsigned int i = 0; i < parallelism_factor && i < ops.size(); ++i)
-        ops[i].Start();
+    // The replicas of the manifest, at the front, are gone before any chunk
+    const std::string key_manifest(ManifestKey(chunkid));
+    unsigned int start = 0;
+    Batch manifests;
+    for (; start < ops.size() && ops[start].k == key_manifest; ++start)
+        manifests.Add(ops[start].client, &ops[start].op);
+    if (!manifests.Empty())
+        manifests.Start()->Wait();
+    // A replica left would describe deleted chunks
+    for (unsigned int i = 0; i < start; ++i) {
+        if (!ops[i].Done()) {
+            LOG(ERROR) << "Manifest of " << chunkid << " not deleted on "
+                       << ops[i].client->Id() << ", chunks kept";
+            return false;
+        }
+    }
 
-    for (unsigned int i = 0; i < ops.size(); ++i) {
+    // Pre-start as many parallel operations as the configured parallelism,
+    // submitted at once
+    Batch batch;
+    const unsigned int first = std::min<size_t>(start + parallelism_factor,
+                                                ops.size());
+    for (unsigned int i = start; i < first; ++i)
+        batch.Add(ops[i].client, &ops[i].op);
+    if (!batch.Empty()) {
+        auto group = batch.Start();
+        for (unsigned int i = start; i < first; ++i)
+            ops[i].sync = group->At(i - start);
+    }
+
+    for (unsigned int i = start; i < ops.size(); ++i) {
         ops[i].sync->Wait();
         // an operation finished, pre-start another one
-        if (i + parallelism_factor + 1 < ops.size())
-            ops[i + parallelism_factor + 1].Start();
+        if (i + parallelism_factor < ops.size())
+            ops[i + parallelism_factor].Start();
     }
 
-    return true;
+    bool done = true;
+    for (unsigned int i = start; i < ops.size(); ++i)
+        done = done && ops[i].Done();
+    return done;
 }
 
 bool Removal::Abort() noexcept {
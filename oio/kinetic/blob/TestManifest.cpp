@@ -0,0 +1,192 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <utils/utils.h>
+#include "Manifest.h"
+
+using oio::kinetic::blob::Manifest;
+using oio::kinetic::blob::ManifestChunk;
+using oio::kinetic::blob::ChunkKey;
+using oio::kinetic::blob::ParseChunkKey;
+using oio::kinetic::blob::ManifestTargets;
+
+static Manifest sample_manifest() noexcept {
+    Manifest m;
+    m.total_size = 3 * 1024 * 1024 + 17;
+    for (unsigned int i = 0; i < 4; ++i) {
+        ManifestChunk c;
+        c.target = "127.0.0.1:600" + std::to_string(i % 3);
+        c.size = i < 3 ? 1024 * 1024 : 17;
+        c.sha1.fill(static_cast<uint8_t>(i));
+        m.chunks.push_back(c);
+    }
+    m.xattr["content-type"] = "application/octet-stream";
+    m.xattr["empty"] = "";
+    return m;
+}
+
+static void test_manifest_roundtrip() noexcept {
+    const auto m = sample_manifest();
+    std::vector<uint8_t> buf;
+    m.Encode(buf);
+
+    Manifest d;
+    assert(d.Decode(buf));
+    assert(d.total_size == m.total_size);
+    assert(!d.chunks_omitted);
+    assert(d.ordered_keys);
+    assert(d.chunks.size() == m.chunks.size());
+    for (unsigned int i = 0; i < m.chunks.size(); ++i) {
+        assert(d.chunks[i].target == m.chunks[i].target);
+        assert(d.chunks[i].size == m.chunks[i].size);
+        assert(d.chunks[i].sha1 == m.chunks[i].sha1);
+    }
+    assert(d.xattr == m.xattr);
+}
+
+static void test_manifest_flags() noexcept {
+    Manifest m;
+    m.total_size = 42;
+    m.chunks_omitted = true;
+    m.ordered_keys = false;
+    std::vector<uint8_t> buf;
+    m.Encode(buf);
+
+    Manifest d;
+    assert(d.Decode(buf));
+    assert(d.total_size == 42);
+    assert(d.chunks_omitted);
+    assert(!d.ordered_keys);
+    assert(d.chunks.empty());
+    assert(d.xattr.empty());
+}
+
+static void test_manifest_malformed() noexcept {
+    std::vector<uint8_t> buf;
+    sample_manifest().Encode(buf);
+    Manifest d;
+
+    // Any truncation is detected
+    for (size_t len = 0; len < buf.size(); ++len) {
+        std::vector<uint8_t> cut(buf.begin(), buf.begin() + len);
+        assert(!d.Decode(cut));
+    }
+
+    // Not a manifest, e.g. the text ones written before
+    std::vector<uint8_t> text{'{', '"', 'a', '"', ':', '1', '}'};
+    assert(!d.Decode(text));
+    auto bad = buf;
+    bad[0] = 'X';
+    assert(!d.Decode(bad));
+
+    // An unknown version
+    bad = buf;
+    bad[4] = Manifest::version + 1;
+    assert(!d.Decode(bad));
+
+    // A chunk pointing past the table of the targets
+    Manifest one;
+    ManifestChunk c;
+    c.target = "t";
+    c.size = 1;
+    c.sha1.fill(0);
+    one.chunks.push_back(c);
+    one.Encode(bad);
+    // magic, version, flags, size, 1 target, 1 chunk, then its index
+    const size_t idx = 4 + 1 + 1 + 8 + 2 + (2 + 1) + 4;
+    assert(bad[idx] == 0 && bad[idx + 1] == 0);
+    assert(d.Decode(bad));
+    bad[idx + 1] = 1;
+    assert(!d.Decode(bad));
+}
+
+static void test_chunk_keys() noexcept {
+    uint32_t seq, size;
+    bool ordered;
+
+    // Both formats, the chunk id itself with dashes
+    for (uint32_t s: {0u, 1u, 9u, 10u, 255u, 65536u, UINT32_MAX}) {
+        const auto k = ChunkKey("a-b-c", s, 1048576);
+        assert(ParseChunkKey(k, seq, size, ordered));
+        assert(ordered && seq == s && size == 1048576);
+
+        const auto l = ChunkKey("a-b-c", s, 17, false);
+        assert(ParseChunkKey(l, seq, size, ordered));
+        assert(!ordered && seq == s && size == 17);
+    }
+    assert(ChunkKey("x", 10, 4096) == "x-=0000000a-00001000");
+    assert(ChunkKey("x", 10, 4096, false) == "x-10-4096");
+
+    // The ordered keys sort as their chunks, within the range listed
+    std::vector<std::string> keys;
+    for (uint32_t s = 0; s < 300; ++s)
+        keys.push_back(ChunkKey("id", s, 300 - s));
+    assert(std::is_sorted(keys.begin(), keys.end()));
+    assert(keys.front() > "id-#" && keys.back() < "id-X");
+    assert(ChunkKey("id", 0, 1, false) < keys.front());
+
+    // Not chunks
+    for (const char *k: {"", "id", "id-#", "id-", "id--", "-1-2", "id-1-",
+                         "id-x-2", "id-1-2x", "id-1-99999999999",
+                         "id-=0000000g-00000001", "id-=00000001-0000000"}) {
+        assert(!ParseChunkKey(k, seq, size, ordered));
+    }
+}
+
+static void test_manifest_targets() noexcept {
+    std::vector<std::string> targets;
+    for (int i = 0; i < 8; ++i)
+        targets.push_back("10.0.0." + std::to_string(i) + ":8123");
+
+    std::vector<std::string> shuffled(targets.rbegin(), targets.rend());
+    std::vector<unsigned int> load(targets.size(), 0);
+    for (int i = 0; i < 1000; ++i) {
+        const auto id = "chunk" + std::to_string(i);
+        const auto t = ManifestTargets(id, targets);
+        assert(t.size() == 2 && t[0] != t[1]);
+        assert(t[0] < targets.size() && t[1] < targets.size());
+        assert(t == ManifestTargets(id, targets));
+        ++load[t[0]];
+
+        // The same drives, whatever their order
+        const auto s = ManifestTargets(id, shuffled);
+        assert(shuffled[s[0]] == targets[t[0]]);
+        assert(shuffled[s[1]] == targets[t[1]]);
+
+        // Removing a drive only moves what it held
+        std::vector<std::string> fewer(targets.begin(), targets.end() - 1);
+        const auto f = ManifestTargets(id, fewer);
+        if (t[0] != targets.size() - 1)
+            assert(f[0] == t[0]);
+    }
+    for (auto l: load)
+        assert(l > 60 && l < 190);
+
+    assert(ManifestTargets("id", {"only"}).size() == 1);
+    assert(ManifestTargets("id", {}).empty());
+    assert(ManifestTargets("id", targets, 3).size() == 3);
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_manifest_roundtrip();
+    test_manifest_flags();
+    test_manifest_malformed();
+    test_chunk_keys();
+    test_manifest_targets();
+    return 0;
+}
@@ -0,0 +1,173 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <libmill.h>
+
+#include <utils/utils.h>
+#include <utils/MemoryBudget.h>
+#include <oio/kinetic/client/ClientInterface.h>
+#include "Upload.h"
+
+using oio::kinetic::client::ClientInterface;
+using oio::kinetic::client::ClientFactory;
+using oio::kinetic::client::CompletionQueue;
+using oio::kinetic::client::DeviceLimits;
+using oio::kinetic::client::Sync;
+using oio::kinetic::blob::UploadBuilder;
+using oio::kinetic::rpc::Exchange;
+using oio::kinetic::rpc::Request;
+namespace proto = ::com::seagate::kinetic::proto;
+
+static constexpr uint32_t block_size = 64 * 1024;
+
+// Bytes written by the uploads, and stored in the chunks
+static uint64_t written = 0;
+static uint64_t stored = 0;
+
+static void reply(Exchange *ex) noexcept {
+    auto req = ex->MakeRequest();
+    const auto &key = req->cmd.body().keyvalue().key();
+    if (key.size() < 2 || key.compare(key.size() - 2, 2, "-#") != 0)
+        stored += req->value.size();
+
+    Request rep;
+    rep.cmd.mutable_status()->set_code(
+            proto::Command_Status_StatusCode_SUCCESS);
+    ex->ManageReply(rep);
+}
+
+// Acknowledged later, as by a drive
+coroutine static void reply_later(Exchange *ex,
+                                  std::shared_ptr<CompletionQueue> cq,
+                                  uint64_t tag) noexcept {
+    msleep(mill_now() + 1);
+    reply(ex);
+    cq->Push(tag);
+}
+
+class Done : public Sync {
+  public:
+    void Wait() { }
+};
+
+/* Accepts everything, holds nothing */
+class FakeDrive : public ClientInterface {
+  public:
+    FakeDrive(const std::string &id) noexcept: id_(id) { }
+
+    std::shared_ptr<Sync> Start(Exchange *ex) noexcept {
+        reply(ex);
+        return std::make_shared<Done>();
+    }
+
+    std::shared_ptr<Sync> Start(Exchange *ex,
+                                std::shared_ptr<CompletionQueue> cq,
+                                uint64_t tag) noexcept {
+        mill_go(reply_later(ex, cq, tag));
+        return std::make_shared<Done>();
+    }
+
+    std::string Id() const noexcept { return id_; }
+
+    DeviceLimits Limits() const noexcept { return DeviceLimits(); }
+
+    bool IsDown() const noexcept { return false; }
+
+    int64_t Latency() const noexcept { return 0; }
+
+  private:
+    std::string id_;
+};
+
+class FakeFactory : public ClientFactory {
+  public:
+    std::shared_ptr<ClientInterface> Get(const std::string &url) noexcept {
+        auto &c = drives_[url];
+        if (!c)
+            c.reset(new FakeDrive(url));
+        return c;
+    }
+
+  private:
+    std::map<std::string, std::shared_ptr<ClientInterface>> drives_;
+};
+
+coroutine static void run_upload(std::shared_ptr<ClientFactory> factory,
+                                 int i, uint64_t limit, chan done) noexcept {
+    UploadBuilder builder(factory);
+    builder.BlockSize(block_size);
+    builder.WindowSize(4 * block_size);
+    builder.Name("blob-" + std::to_string(i));
+    for (int d = 0; d < 3; ++d)
+        builder.Target("127.0.0.1:600" + std::to_string(d));
+    auto up = builder.Build();
+    auto rc = up->Prepare();
+    assert(rc == oio::blob::Upload::Status::OK);
+
+    // Several blocks per write, then through the buffer of the upload
+    std::vector<uint8_t> buf(3 * block_size + 17, 'x');
+    for (int j = 0; j < 4; ++j) {
+        up->Write(buf.data(), buf.size());
+        written += buf.size();
+        assert(MemoryBudget::Default().Used() <= limit);
+    }
+    for (int j = 0; j < 16; ++j) {
+        uint32_t len = 0;
+        auto p = up->Reserve(block_size / 3, len);
+        assert(len > 0);
+        // Short reads leave room to the next Reserve()
+        const uint32_t got = j % 3 ? len : len / 2;
+        memset(p, 'y', got);
+        up->Written(got);
+        written += got;
+        assert(MemoryBudget::Default().Used() <= limit);
+    }
+    const bool ok = up->Commit();
+    up.reset();
+    chs(done, int, ok ? 1 : 0);
+}
+
+// Many uploads against a budget of a few blocks: each one must give back
+// the blocks the drives acknowledged while it waits for the budget.
+static void test_tiny_budget() noexcept {
+    const uint64_t limit = 2 * block_size;
+    const int nb = 8;
+    MemoryBudget::Default().SetLimit(limit);
+
+    std::shared_ptr<ClientFactory> factory(new FakeFactory);
+    chan done = chmake(int, nb);
+    for (int i = 0; i < nb; ++i)
+        mill_go(run_upload(factory, i, limit, done));
+    for (int i = 0; i < nb; ++i) {
+        mill_choose {
+            mill_in(done, int, ok):
+                assert(ok);
+            mill_deadline(mill_now() + 10000):
+                LOG(FATAL) << "Uploads stuck on the memory budget";
+            mill_end
+        }
+    }
+    chclose(done);
+    assert(stored == written);
+    assert(MemoryBudget::Default().Used() == 0);
+    MemoryBudget::Default().SetLimit(0);
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_tiny_budget();
+    return 0;
+}
@@ -4,24 +4,41 @@
  * v. 2.0. If a copy of the MPL was not distributed with this file, you can
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
-#include <sstream>
-
+#include <algorithm>
+#include <cassert>
 #include <glog/log_severity.h>
 #include <glog/logging.h>
-#include <rapidjson/document.h>
-#include <rapidjson/writer.h>
+#include <openssl/sha.h>
 #include <libmill.h>
+#include <utils/BufferPool.h>
+#include <utils/MemoryBudget.h>
 #include <oio/kinetic/rpc/Put.h>
 #include <oio/kinetic/rpc/GetKeyRange.h>
 #include <oio/kinetic/client/ClientInterface.h>
+#include <oio/kinetic/client/Batch.h>
+#include <oio/kinetic/client/CompletionQueue.h>
+#include "Manifest.h"
 #include "Upload.h"
 
 using oio::kinetic::blob::UploadBuilder;
+using oio::kinetic::blob::Manifest;
+using oio::kinetic::blob::ChunkKey;
+using oio::kinetic::blob::ManifestKey;
+using oio::kinetic::blob::ManifestTargets;
+using oio::kinetic::blob::ManifestChunk;
 using oio::kinetic::client::ClientInterface;
 using oio::kinetic::client::ClientFactory;
 using oio::kinetic::client::Sync;
+using oio::kinetic::client::Batch;
+using oio::kinetic::client::CompletionQueue;
 using oio::kinetic::rpc::Put;
 using oio::kinetic::rpc::GetKeyRange;
+namespace proto = ::com::seagate::kinetic::proto;
+
+struct PendingPut {
+    std::unique_ptr<Put> put;
+    uint32_t size;
+};
 
 class Upload : public oio::blob::Upload {
     friend class UploadBuilder;
@@ -43,63 +60,191 @@ public:
 
     void Write(const std::string &s) noexcept;
 
+    uint8_t *Reserve(uint32_t max, uint32_t &len) noexcept;
+
+    void Written(uint32_t len) noexcept;
+
     void Flush() noexcept;
 
 private:
-    void TriggerUpload() noexcept;
+    // Without a batch, the PUT starts at once
+    void TriggerUpload(Batch *batch = nullptr) noexcept;
 
-    void TriggerUpload(const std::string &suffix) noexcept;
+    // Waits for a block in flight, then frees it
+    void reap() noexcept;
+
+    // Reserves the memory of the buffer and gives it its whole capacity,
+    // before it is filled
+    void prepare_buffer() noexcept;
+
+    // Bounds the blocks to the values accepted by every device. Their
+    // limits are only known once they are connected.
+    void clamp_block() noexcept;
+
+    // Indexes of the clients designated for the manifest
+    std::vector<unsigned int> manifest_targets() const noexcept;
+
+    // Looks for the manifest on the clients given, those up. Returns how
+    // many were asked.
+    unsigned int find_manifest(const std::vector<unsigned int> &which,
+                               bool &found) noexcept;
 
 private:
     std::vector<std::shared_ptr<ClientInterface>> clients;
     uint32_t next_client;
+    // The blocks sent while writing, by tag
+    std::map<uint64_t, PendingPut> inflight;
+    std::shared_ptr<CompletionQueue> cq;
+    uint64_t next_tag;
+    uint64_t inflight_bytes;
+    uint64_t window_bytes;
+    bool failed;
+
+    // The blocks sent at the commit
     std::vector<std::shared_ptr<Put>> puts;
     std::vector<std::shared_ptr<Sync>> syncs;
 
+    // Its first `filled` bytes are the payload, the rest was initialized
+    // for Reserve() and is reused by the next ones.
     std::vector<uint8_t> buffer;
+    uint32_t filled;
+    uint32_t block_size; // as configured
     uint32_t buffer_limit;
+    uint32_t reserved; // room given by Reserve(), after the payload
+    uint64_t held; // memory reserved for the buffer
+    uint64_t committed_bytes; // the blocks sent at the commit
     std::string chunkid;
     std::map<std::string,std::string> xattr;
+    bool background;
+
+    // What the manifest will tell
+    std::vector<ManifestChunk> chunks;
+    uint64_t total_size;
 };
 
 Upload::~Upload() noexcept {
     DLOG(INFO) << __FUNCTION__;
+    // The blocks in flight are still referenced by their client
+    while (!inflight.empty())
+        reap();
+    BufferPool::Default().Release(buffer);
+    MemoryBudget::Default().Release(held + committed_bytes);
 }
 
-Upload::Upload() noexcept: clients(), next_client{0}, puts(), syncs() {
+Upload::Upload() noexcept: clients(), next_client{0}, inflight(),
+                           cq(new CompletionQueue), next_tag{0},
+                           inflight_bytes{0}, window_bytes{0}, failed{false},
+                           puts(), syncs(), buffer(), filled{0},
+                           block_size{0},
+                           buffer_limit{0},
+                           reserved{0}, held{0}, committed_bytes{0},
+                           background{false}, chunks(), total_size{0} {
     DLOG(INFO) << __FUNCTION__;
 }
 
+std::vector<unsigned int> Upload::manifest_targets() const noexcept {
+    std::vector<std::string> ids;
+    for (const auto &c: clients)
+        ids.push_back(c->Id());
+    return ManifestTargets(chunkid, ids);
+}
+
 void Upload::SetXattr(const std::string &k, const std::string &v) noexcept {
     xattr[k] = v;
 }
 
-void Upload::TriggerUpload(const std::string &suffix) noexcept {
+void Upload::TriggerUpload(Batch *batch) noexcept {
     assert(!chunkid.empty());
     assert(clients.size() > 0);
 
+    // Avoid the drives known to be down, as long as one is up
     auto client = clients[next_client % clients.size()];
-    std::stringstream ss;
-    ss << chunkid;
-    ss << '-';
-    ss << suffix;
+    for (unsigned int i = 1; client->IsDown() && i < clients.size(); ++i)
+        client = clients[(next_client + i) % clients.size()];
+
+    buffer.resize(filled);
+    filled = 0;
+
+    ManifestChunk mc;
+    mc.target = client->Id();
+    mc.size = buffer.size();
+    ::SHA1(buffer.data(), buffer.size(), mc.sha1.data());
+    chunks.push_back(std::move(mc));
+    total_size += buffer.size();
+    const auto key = ChunkKey(chunkid, next_client, buffer.size());
     next_client++;
 
+    // The block keeps the memory it actually uses
+    const uint32_t size = buffer.size();
+    assert(held >= size);
+    MemoryBudget::Default().Release(held - size);
+    held = 0;
     Put *put = new Put;
-    put->Key(ss.str());
+    put->Key(key);
     put->Value(buffer);
     assert(buffer.size() == 0);
+    if (background)
+        put->SetPriority(proto::Command_Priority_LOWER);
+
+    if (batch != nullptr) {
+        committed_bytes += size;
+        puts.emplace_back(put);
+        batch->Add(client, put);
+        return;
+    }
+
+    // Slow the writer down to the pace of the drives
+    while (!inflight.empty() && inflight_bytes + size > window_bytes)
+        reap();
+    const auto tag = next_tag++;
+    auto &pp = inflight[tag];
+    pp.put.reset(put);
+    pp.size = size;
+    inflight_bytes += size;
+    (void) client->Start(put, cq, tag);
+}
 
-    puts.emplace_back(put);
-    syncs.emplace_back(client->Start(put));
+void Upload::clamp_block() noexcept {
+    buffer_limit = block_size;
+    for (const auto &c: clients) {
+        const auto limits = c->Limits();
+        if (limits.max_value_size > 0 && buffer_limit > limits.max_value_size)
+            buffer_limit = limits.max_value_size;
+    }
+}
+
+void Upload::prepare_buffer() noexcept {
+    if (held == 0) {
+        // A new block, the drives may have told their limits meanwhile
+        clamp_block();
+        // Never wait for the budget while holding blocks in flight: only
+        // this coroutine releases them, and with every upload waiting,
+        // nothing would ever be released.
+        auto &budget = MemoryBudget::Default();
+        while (!cq->Empty())
+            reap();
+        while (!budget.TryAcquire(buffer_limit)) {
+            if (inflight.empty()) {
+                (void) budget.Acquire(buffer_limit, -1);
+                break;
+            }
+            reap();
+        }
+        held = buffer_limit;
+    }
+    if (buffer.empty() && buffer.capacity() < buffer_limit)
+        buffer = BufferPool::Default().Acquire(buffer_limit);
 }
 
-void Upload::TriggerUpload() noexcept {
-    std::stringstream ss;
-    ss << next_client;
-    ss << '-';
-    ss << buffer.size();
-    return TriggerUpload(ss.str());
+void Upload::reap() noexcept {
+    assert(!inflight.empty());
+    auto it = inflight.find(cq->Wait());
+    assert(it != inflight.end());
+    if (!it->second.put->Ok())
+        failed = true;
+    inflight_bytes -= it->second.size;
+    MemoryBudget::Default().Release(it->second.size);
+    inflight.erase(it);
 }
 
 void Upload::Write(const uint8_t *buf, uint32_t len) noexcept {
@@ -107,57 +252,121 @@ void Upload::Write(const uint8_t *buf, uint32_t len) noexcept {
 
     while (len > 0) {
         bool action = false;
-        const auto oldsize = buffer.size();
-        const uint32_t avail = buffer_limit - oldsize;
+        prepare_buffer();
+        const uint32_t avail = buffer_limit - filled;
         const uint32_t local = std::min(avail, len);
         if (local > 0) {
-            buffer.resize(oldsize + local);
-            memcpy(buffer.data() + oldsize, buf, local);
+            buffer.resize(filled);
+            buffer.insert(buffer.end(), buf, buf + local);
+            filled += local;
             buf += local;
             len -= local;
             action = true;
         }
-        if (buffer.size() >= buffer_limit) {
+        if (filled >= buffer_limit) {
             TriggerUpload();
             action = true;
         }
         assert(action);
     }
+    // Free the blocks already acknowledged
+    while (!cq->Empty())
+        reap();
     yield();
 }
 
+uint8_t *Upload::Reserve(uint32_t max, uint32_t &len) noexcept {
+    assert(reserved == 0);
+    if (filled >= buffer_limit)
+        TriggerUpload();
+    prepare_buffer();
+    len = reserved = std::min<uint32_t>(max, buffer_limit - filled);
+    // The room left by the previous calls is reused: each byte of the block
+    // is zeroed by resize() once, not on each read.
+    if (buffer.size() < filled + len)
+        buffer.resize(filled + len);
+    return buffer.data() + filled;
+}
+
+void Upload::Written(uint32_t len) noexcept {
+    assert(len <= reserved);
+    filled += len;
+    reserved = 0;
+    if (filled >= buffer_limit)
+        TriggerUpload();
+    while (!cq->Empty())
+        reap();
+}
+
 void Upload::Write(const std::string &s) noexcept {
     return Write(reinterpret_cast<const uint8_t *>(s.data()), s.size());
 }
 
 void Upload::Flush() noexcept {
-    DLOG(INFO) << __FUNCTION__ << " of "<< buffer.size() << " bytes";
-    if (buffer.size() > 0)
+    DLOG(INFO) << __FUNCTION__ << " of "<< filled << " bytes";
+    if (filled > 0)
         TriggerUpload();
 }
 
 bool Upload::Commit() noexcept {
 
-    // Flush the internal buffer so that we don't mix payload with xattr
-    Flush();
+    // The last block and the manifest leave together
+    Batch batch;
+    if (filled > 0)
+        TriggerUpload(&batch);
+
+    Manifest manifest;
+    manifest.total_size = total_size;
+    manifest.chunks.swap(chunks);
+    manifest.xattr = xattr;
+    // A replica on each designated drive that is up. Elsewhere, the next
+    // uploads and removals would not find it.
+    std::vector<std::shared_ptr<ClientInterface>> targets;
+    for (auto idx: manifest_targets()) {
+        if (!clients[idx]->IsDown())
+            targets.push_back(clients[idx]);
+    }
+    if (targets.empty()) {
+        LOG(ERROR) << "No drive up for the manifest of " << chunkid;
+        failed = true;
+    }
 
-    // Pack then send the xattr
-    rapidjson::StringBuffer buf;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
-    writer.StartObject();
-    for (const auto &e: xattr) {
-        writer.Key(e.first.c_str());
-        writer.String(e.second.c_str());
+    std::vector<uint8_t> value;
+    manifest.Encode(value);
+    uint32_t max_size = 0;
+    for (const auto &t: targets) {
+        const auto m = t->Limits().max_value_size;
+        if (m > 0 && (max_size == 0 || m < max_size))
+            max_size = m;
+    }
+    if (max_size > 0 && value.size() > max_size) {
+        manifest.chunks_omitted = true;
+        manifest.chunks.clear();
+        manifest.Encode(value);
     }
-    writer.EndObject();
-    this->Write(reinterpret_cast<const uint8_t *>(buf.GetString()), buf.GetSize());
-    TriggerUpload("#");
 
+    for (const auto &t: targets) {
+        Put *put = new Put;
+        put->Key(ManifestKey(chunkid));
+        put->Value(value);
+        if (background)
+            put->SetPriority(proto::Command_Priority_LOWER);
+        puts.emplace_back(put);
+        batch.Add(t, put);
+    }
+    if (!batch.Empty())
+        syncs.emplace_back(batch.Start());
 
     // Wait for all the single PUT to finish
+    while (!inflight.empty())
+        reap();
     for (auto &s: syncs)
         s->Wait();
-    return true;
+    MemoryBudget::Default().Release(committed_bytes);
+    committed_bytes = 0;
+    for (const auto &p: puts)
+        failed = failed || !p->Ok();
+    return !failed;
 }
 
 bool Upload::Abort() noexcept {
@@ -166,31 +375,49 @@ bool Upload::Abort() noexcept {
 
 oio::blob::Upload::Status Upload::Prepare() noexcept {
 
-    // Send the same listing request to all the clients
-    const std::string key_manifest(chunkid + "-#");
-    GetKeyRange gkr;
-    gkr.Start(key_manifest);
-    gkr.End(key_manifest);
-    gkr.IncludeStart(true);
-    gkr.IncludeEnd(true);
-    gkr.MaxItems(1);
+    // Only the drives designated for the manifest may hold it, one of them
+    // must be up to write it. The manifests placed before the rendezvous
+    // hashing are not looked for: that would ask every drive on each PUT.
+    bool found = false;
+    if (0 == find_manifest(manifest_targets(), found))
+        return oio::blob::Upload::Status::NetworkError;
+    return found ? oio::blob::Upload::Status::Already
+                 : oio::blob::Upload::Status::OK;
+}
+
+unsigned int Upload::find_manifest(const std::vector<unsigned int> &which,
+                                   bool &found) noexcept {
+    const std::string key_manifest(ManifestKey(chunkid));
+    std::vector<std::unique_ptr<GetKeyRange>> gkrs;
     std::vector<std::shared_ptr<Sync>> ops;
-    for (auto cli: clients)
-        ops.push_back(cli->Start(&gkr));
+    for (auto idx: which) {
+        if (clients[idx]->IsDown())
+            continue;
+        GetKeyRange *gkr = new GetKeyRange;
+        gkr->Start(key_manifest);
+        gkr->End(key_manifest);
+        gkr->IncludeStart(true);
+        gkr->IncludeEnd(true);
+        gkr->MaxItems(1);
+        gkr->SetPriority(proto::Command_Priority_HIGHER);
+        gkrs.emplace_back(gkr);
+        ops.push_back(clients[idx]->Start(gkr));
+    }
     for (auto op: ops)
         op->Wait();
-    std::vector<std::string> keys;
-    gkr.Steal(keys);
-    if (!keys.empty())
-        return oio::blob::Upload::Status::Already;
-
-    return oio::blob::Upload::Status::OK;
+    for (auto &gkr: gkrs) {
+        std::vector<std::string> keys;
+        gkr->Steal(keys);
+        found = found || !keys.empty();
+    }
+    return ops.size();
 }
 
 UploadBuilder::~UploadBuilder() noexcept { }
 
 UploadBuilder::UploadBuilder(std::shared_ptr<ClientFactory> f) noexcept:
-        factory(f), targets(), block_size{512 * 1024} { }
+        factory(f), targets(), block_size{512 * 1024},
+        window_size{8 * 1024 * 1024}, background{false} { }
 
 void UploadBuilder::Target(const std::string &to) noexcept {
     targets.insert(to);
@@ -214,14 +441,25 @@ void UploadBuilder::BlockSize(uint32_t s) noexcept {
     block_size = s;
 }
 
+void UploadBuilder::WindowSize(uint64_t s) noexcept {
+    window_size = s;
+}
+
+void UploadBuilder::Background(bool b) noexcept {
+    background = b;
+}
+
 std::unique_ptr<oio::blob::Upload> UploadBuilder::Build() noexcept {
     assert(!name.empty());
 
     Upload *ul = new Upload();
-    ul->buffer_limit = block_size;
+    ul->block_size = block_size;
     ul->chunkid.assign(name);
+    ul->window_bytes = window_size;
+    ul->background = background;
     for (const auto &to: targets)
         ul->clients.emplace_back(factory->Get(to.c_str()));
+    ul->clamp_block();
     DLOG(INFO) << __FUNCTION__ << " with " << static_cast<int>(ul->clients.size());
     return std::unique_ptr<Upload>(ul);
 }
@@ -31,6 +31,13 @@ class UploadBuilder {
 
     void BlockSize(uint32_t s) noexcept;
 
+    // Bytes of blocks sent but not acknowledged yet. Beyond, the writer
+    // waits for the drives.
+    void WindowSize(uint64_t s) noexcept;
+
+    // The blocks yield to the other exchanges on the drives
+    void Background(bool b) noexcept;
+
     std::unique_ptr<oio::blob::Upload> Build() noexcept;
 
   private:
@@ -38,6 +45,8 @@ class UploadBuilder {
     std::set<std::string> targets;
     std::string name;
     uint32_t block_size;
+    uint64_t window_size;
+    bool background;
 };
 
 } // namespace rpc
@@ -0,0 +1,38 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <map>
+#include "Batch.h"
+
+using oio::kinetic::rpc::Exchange;
+using oio::kinetic::client::Batch;
+using oio::kinetic::client::ClientInterface;
+using oio::kinetic::client::SyncGroup;
+
+void Batch::Add(std::shared_ptr<ClientInterface> client,
+                Exchange *ex) noexcept {
+    items.emplace_back(client, ex);
+}
+
+std::shared_ptr<SyncGroup> Batch::Start() noexcept {
+    // Group the exchanges by client, in the order of their addition
+    std::map<ClientInterface *, std::vector<Exchange *>> shares;
+    for (const auto &item: items)
+        shares[item.first.get()].push_back(item.second);
+
+    std::map<ClientInterface *, std::shared_ptr<SyncGroup>> parts;
+    std::map<ClientInterface *, size_t> next;
+    for (const auto &share: shares)
+        parts[share.first] = share.first->StartMany(share.second);
+
+    std::shared_ptr<SyncGroup> group(new SyncGroup);
+    for (const auto &item: items) {
+        auto cli = item.first.get();
+        group->Add(parts[cli]->At(next[cli]++));
+    }
+    items.clear();
+    return group;
+}
@@ -0,0 +1,45 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_BATCH_H
+#define OIO_KINETIC_CLIENT_BATCH_H
+
+#include <memory>
+#include <vector>
+#include <oio/kinetic/rpc/Exchange.h>
+#include "ClientInterface.h"
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* Collects RPC for several clients, then submits them with a single
+ * StartMany() per client. */
+class Batch {
+  public:
+    Batch() noexcept: items() { }
+
+    ~Batch() noexcept { }
+
+    void Add(std::shared_ptr<ClientInterface> client,
+             oio::kinetic::rpc::Exchange *ex) noexcept;
+
+    bool Empty() const noexcept { return items.empty(); }
+
+    // The syncs of the group follow the order of the Add() calls.
+    // The batch is empty afterwards.
+    std::shared_ptr<SyncGroup> Start() noexcept;
+
+  private:
+    std::vector<std::pair<std::shared_ptr<ClientInterface>,
+            oio::kinetic::rpc::Exchange *>> items;
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_BATCH_H
@@ -0,0 +1,153 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <netinet/in.h>
+
+#include <glog/logging.h>
+#include <libmill.h>
+
+#include <utils/utils.h>
+#include <utils/MillSocket.h>
+#include "FrameReader.h"
+#include "Packer.h"
+
+using oio::kinetic::client::Frame;
+using oio::kinetic::client::FrameReader;
+using oio::kinetic::client::Packer;
+using oio::kinetic::client::Credentials;
+using oio::kinetic::rpc::Request;
+namespace proto = ::com::seagate::kinetic::proto;
+
+static void append_frame(std::vector<uint8_t> &dst,
+                         uint32_t lenmsg, uint32_t lenval) noexcept {
+    uint8_t hdr[9] = {'F', 0, 0, 0, 0, 0, 0, 0, 0};
+    *((uint32_t *) (hdr + 1)) = ::htonl(lenmsg);
+    *((uint32_t *) (hdr + 5)) = ::htonl(lenval);
+    dst.insert(dst.end(), hdr, hdr + 9);
+    dst.resize(dst.size() + lenmsg + lenval, 'x');
+}
+
+coroutine static void bench_writer(MillSocket *sock, const uint8_t *buf,
+                                   size_t len, unsigned int rounds,
+                                   chan done) noexcept {
+    for (unsigned int i = 0; i < rounds; ++i) {
+        if (!sock->send(const_cast<uint8_t *>(buf), len, mill_now() + 5000))
+            break;
+    }
+    chs(done, int, 0);
+}
+
+// The decoding in use before the FrameReader: 3 reads per frame
+static int legacy_recv(MillSocket &sock, Frame &frame, int64_t dl) noexcept {
+    uint8_t hdr[9];
+    if (!sock.read_exactly(hdr, 9, dl))
+        return EAGAIN;
+    frame.msg.resize(::ntohl(*(uint32_t *) (hdr + 1)));
+    frame.val.resize(::ntohl(*(uint32_t *) (hdr + 5)));
+    if (!sock.read_exactly(frame.msg.data(), frame.msg.size(), dl))
+        return EIO;
+    if (!sock.read_exactly(frame.val.data(), frame.val.size(), dl))
+        return EIO;
+    return 0;
+}
+
+static void bench_frames(const char *url, bool buffered,
+                         uint32_t lenmsg, uint32_t lenval, unsigned int nb) {
+    MillSocket srv, cli, peer;
+    if (!srv.bind(url) || !srv.listen(16) || !cli.connect(url)) {
+        LOG(ERROR) << "Socket setup error: " << ::strerror(errno);
+        ::exit(1);
+    }
+    while (!srv.accept(peer))
+        fdwait(srv.fileno(), FDW_IN, mill_now() + 1000);
+
+    // Preformat a batch of frames, sent in a loop
+    const unsigned int batch = lenval > 65536 ? 4 : 64;
+    std::vector<uint8_t> buf;
+    for (unsigned int i = 0; i < batch; ++i)
+        append_frame(buf, lenmsg, lenval);
+
+    chan done = chmake(int, 1);
+    mill_go(bench_writer(&peer, buf.data(), buf.size(), nb / batch, done));
+
+    FrameReader reader(cli);
+    const auto pre = std::chrono::steady_clock::now();
+    unsigned int count = 0;
+    for (Frame frame; count < (nb / batch) * batch; ++count) {
+        const auto dl = mill_now() + 1000;
+        int err = buffered ? reader.Read(frame, dl) : legacy_recv(cli, frame, dl);
+        if (err != 0)
+            break;
+    }
+    const auto post = std::chrono::steady_clock::now();
+    (void) chr(done, int);
+    chclose(done);
+
+    const auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+            post - pre).count();
+    LOG(INFO) << (buffered ? "reader" : "legacy")
+              << " msg=" << lenmsg << " val=" << lenval
+              << " frames=" << count << " usec=" << usec
+              << " frames/s=" << (usec > 0 ? (count * 1000000.0) / usec : 0);
+
+    peer.close();
+    cli.close();
+    srv.close();
+}
+
+static void bench_pack(uint32_t lenval, unsigned int nb) {
+    Packer packer(Credentials{});
+    Request req;
+    auto h = req.cmd.mutable_header();
+    h->set_messagetype(proto::Command_MessageType_PUT);
+    h->set_sequence(1);
+    auto kv = req.cmd.mutable_body()->mutable_keyvalue();
+    kv->set_key("bench-0123456789abcdef-00000000");
+    kv->set_algorithm(proto::Command_Algorithm_SHA1);
+    kv->set_force(true);
+    req.value.resize(lenval, 'x');
+
+    Frame frame;
+    size_t bytes = 0;
+    const auto pre = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < nb; ++i) {
+        packer.Pack(req, 1, proto::Command_Priority_NORMAL, 1000, frame);
+        bytes += 9 + frame.msg.size() + frame.val.size();
+        req.value.swap(frame.val);
+    }
+    const auto post = std::chrono::steady_clock::now();
+
+    const auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+            post - pre).count();
+    LOG(INFO) << "pack val=" << lenval << " frames=" << nb << " usec=" << usec
+              << " frames/s=" << (usec > 0 ? (nb * 1000000.0) / usec : 0)
+              << " MiB/s=" << (usec > 0 ? bytes / (1.048576 * usec) : 0);
+}
+
+int main(int argc, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    const char *url = argc > 1 ? argv[1] : "127.0.0.1:6123";
+    const unsigned int nb = 256 * 1024;
+
+    struct { uint32_t msg, val; } sizes[] = {
+            {64, 0}, {256, 0}, {256, 4096}, {256, 1024 * 1024}
+    };
+    for (const auto &sz: sizes) {
+        const unsigned int count = sz.val > 65536 ? 1024 : nb;
+        bench_frames(url, false, sz.msg, sz.val, count);
+        bench_frames(url, true, sz.msg, sz.val, count);
+    }
+
+    bench_pack(4096, 256 * 1024);
+    bench_pack(1024 * 1024, 1024);
+    return 0;
+}
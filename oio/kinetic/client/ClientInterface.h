@@ -7,12 +7,14 @@
 #ifndef OIO_KINETIC_CLIENT_CLIENTINTERFACE_H
 #define OIO_KINETIC_CLIENT_CLIENTINTERFACE_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 #include <kinetic.pb.h>
 #include <oio/kinetic/rpc/Request.h>
 #include <oio/kinetic/rpc/Exchange.h>
+#include "CompletionQueue.h"
 
 namespace oio {
 namespace kinetic {
@@ -26,12 +28,85 @@ class Sync {
     virtual void Wait() = 0;
 };
 
+/* Limits advertised by a device. 0 means no known limit. */
+struct DeviceLimits {
+    uint32_t max_key_size;
+    uint32_t max_value_size;
+    uint32_t max_message_size;
+    uint32_t max_outstanding_reads;
+    uint32_t max_outstanding_writes;
+
+    // The defaults of the Kinetic specification
+    DeviceLimits() noexcept:
+            max_key_size{4096}, max_value_size{1024 * 1024},
+            max_message_size{1024 * 1024},
+            max_outstanding_reads{0}, max_outstanding_writes{0} { }
+};
+
+/* How a client authenticates to a device */
+struct Credentials {
+    int64_t identity;
+    std::string key;
+
+    // The demo account of the Kinetic devices
+    Credentials() noexcept: identity{1}, key("asdfasdf") { }
+
+    Credentials(int64_t i, const std::string &k) noexcept:
+            identity{i}, key(k) { }
+};
+
+/* Several pending RPC, waited for as a whole */
+class SyncGroup : public Sync {
+  public:
+    SyncGroup() noexcept: syncs() { }
+
+    ~SyncGroup() { }
+
+    void Add(std::shared_ptr<Sync> s) noexcept { syncs.emplace_back(s); }
+
+    size_t Size() const noexcept { return syncs.size(); }
+
+    // The i-th RPC, in the order of submission
+    std::shared_ptr<Sync> At(size_t i) const noexcept { return syncs[i]; }
+
+    void Wait() {
+        for (auto &s: syncs)
+            s->Wait();
+    }
+
+  private:
+    std::vector<std::shared_ptr<Sync>> syncs;
+};
+
 class ClientInterface {
   public:
     virtual std::shared_ptr<Sync> Start(
             oio::kinetic::rpc::Exchange *ex) noexcept = 0;
 
+    // Same as above, `tag` is also pushed into `cq` at the completion
+    virtual std::shared_ptr<Sync> Start(
+            oio::kinetic::rpc::Exchange *ex,
+            std::shared_ptr<CompletionQueue> cq, uint64_t tag) noexcept = 0;
+
+    // Submits several RPC at once. The default does one Start() for each.
+    virtual std::shared_ptr<SyncGroup> StartMany(
+            const std::vector<oio::kinetic::rpc::Exchange *> &exs) noexcept {
+        std::shared_ptr<SyncGroup> group(new SyncGroup);
+        for (auto ex: exs)
+            group->Add(Start(ex));
+        return group;
+    }
+
     virtual std::string Id() const noexcept = 0;
+
+    virtual DeviceLimits Limits() const noexcept = 0;
+
+    // Tells if the drive is known to be unreachable. Its exchanges then
+    // fail at once.
+    virtual bool IsDown() const noexcept = 0;
+
+    // Smoothed round-trip time to the drive, in microseconds, 0 if unknown
+    virtual int64_t Latency() const noexcept = 0;
 };
 
 class ClientFactory {
@@ -0,0 +1,40 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <libmill.h>
+#include "CompletionQueue.h"
+
+using oio::kinetic::client::CompletionQueue;
+
+CompletionQueue::CompletionQueue() noexcept:
+        ready_(), doorbell_{nullptr}, sleeping_{false} {
+    doorbell_ = chmake(int, 1);
+}
+
+CompletionQueue::~CompletionQueue() noexcept {
+    assert(!sleeping_);
+    chclose(doorbell_);
+}
+
+void CompletionQueue::Push(uint64_t tag) noexcept {
+    ready_.push_back(tag);
+    // Only ring for a sleeper, so that the doorbell never blocks
+    if (sleeping_) {
+        sleeping_ = false;
+        chs(doorbell_, int, 0);
+    }
+}
+
+uint64_t CompletionQueue::Wait() noexcept {
+    while (ready_.empty()) {
+        sleeping_ = true;
+        (void) chr(doorbell_, int);
+    }
+    const auto tag = ready_.front();
+    ready_.pop_front();
+    return tag;
+}
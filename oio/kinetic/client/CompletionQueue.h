@@ -0,0 +1,48 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_COMPLETIONQUEUE_H
+#define OIO_KINETIC_CLIENT_COMPLETIONQUEUE_H
+
+#include <cstdint>
+#include <deque>
+
+struct mill_chan;
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* Collects the tags of the exchanges that completed, in the order of their
+ * completion, so that a single coroutine can wait for any of them. */
+class CompletionQueue {
+  public:
+    CompletionQueue() noexcept;
+
+    ~CompletionQueue() noexcept;
+
+    void Push(uint64_t tag) noexcept;
+
+    // Blocks until an exchange completes, then returns its tag
+    uint64_t Wait() noexcept;
+
+    bool Empty() const noexcept { return ready_.empty(); }
+
+  private:
+    CompletionQueue(const CompletionQueue &o) = delete;
+
+    CompletionQueue(CompletionQueue &&o) = delete;
+
+    std::deque<uint64_t> ready_;
+    struct mill_chan *doorbell_;
+    bool sleeping_; // a coroutine waits for the doorbell
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_COMPLETIONQUEUE_H
@@ -4,29 +4,67 @@
  * v. 2.0. If a copy of the MPL was not distributed with this file, you can
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
-#include <utility>
 #include <algorithm>
+#include <utility>
 #include <sstream>
+#include <climits>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include <glog/logging.h>
 #include <glog/log_severity.h>
 #include <libmill.h>
 
 #include "utils/utils.h"
+#include "utils/PoolAllocator.h"
+#include "utils/BufferPool.h"
 #include "CoroutineClient.h"
 
 using oio::kinetic::rpc::Request;
 using oio::kinetic::rpc::Exchange;
 using oio::kinetic::client::CoroutineClient;
 using oio::kinetic::client::Sync;
-
-CoroutineClient::CoroutineClient(const std::string &u) noexcept:
-        url_{u}, sock_(), cnxid_{0}, seqid_{2},
-        waiting_(), pending_(),
+using oio::kinetic::client::SyncGroup;
+using oio::kinetic::client::CompletionQueue;
+using oio::kinetic::client::DeviceLimits;
+using oio::kinetic::client::Credentials;
+using oio::kinetic::client::PendingExchange;
+using oio::kinetic::client::RequestClass;
+
+// Delay of inactivity before a NOOP checks the connection, in ms
+static constexpr int64_t keepalive_delay = 5000;
+
+// Bounds of the delays derived from the latencies, in ms
+static constexpr int64_t min_reply_timeout = 250;
+static constexpr uint64_t min_latency_samples = 32;
+static constexpr int64_t min_send_delay = 1000;
+
+// Bounds of the replays after a connection loss
+static constexpr unsigned int max_attempts = 3;
+static constexpr int64_t min_backoff = 100;
+static constexpr int64_t max_backoff = 5000;
+
+// Upper bounds of the frames sent with a single writev()
+static constexpr unsigned int max_batch_frames = IOV_MAX / 3;
+static constexpr size_t max_batch_bytes = 4 * 1024 * 1024;
+
+CoroutineClient::CoroutineClient(const std::string &u,
+                                 const Credentials &c,
+                                 std::shared_ptr<DriveHealth> h) noexcept:
+        url_{u}, sock_(), reader_(sock_), packer_(c), cnxid_{0}, seqid_{2},
+        waiting_(), pending_(), limits_(), limits_known_{false},
+        limits_query_(), limits_pending_(),
+        health_(h), probe_(), probe_pending_(), next_probe_{0},
+        last_activity_{0}, rtt_(), latencies_(),
+        inflight_reads_{0}, inflight_writes_{0}, stalled_{false}, kicked_{false},
+        broken_{false}, backoff_{0},
+        timeout_{5000}, next_sweep_{0},
         to_agent_{nullptr}, stopped_{nullptr}, running_{false} {
     to_agent_ = chmake(int, 64);
     stopped_ = chmake(int, 2);
+    limits_query_.Type(proto::Command_GetLog_Type_LIMITS);
+    if (health_ == nullptr)
+        health_.reset(new DriveHealth(u));
 }
 
 CoroutineClient::~CoroutineClient() noexcept {
@@ -49,33 +87,9 @@ std::string CoroutineClient::debug_string() const noexcept {
     return ss.str();
 }
 
-int CoroutineClient::recv(Frame &frame, int64_t dl) noexcept {
-
-    constexpr uint32_t max = 1024 * 1024;
-    uint8_t hdr[9];
-
-    if (!sock_.read_exactly(hdr, 9, dl))
-        return EAGAIN;
-    if (hdr[0] != 'F')
-        return EBADMSG;
-
-    uint32_t lenmsg = ::ntohl(*(uint32_t *) (hdr + 1));
-    uint32_t lenval = ::ntohl(*(uint32_t *) (hdr + 5));
-    if (lenval > max || lenmsg > max)
-        return E2BIG;
-
-    frame.msg.resize(lenmsg);
-    frame.val.resize(lenval);
-
-    if (!sock_.read_exactly(frame.msg.data(), frame.msg.size(), dl))
-        return errno;
-    if (!sock_.read_exactly(frame.val.data(), frame.val.size(), dl))
-        return errno;
-    return 0;
-}
-
 bool CoroutineClient::manage(Frame &frame) noexcept {
-    Request req;
+    // Parsing into the same messages reuses their allocations
+    Request &req = reply_;
 
     req.msg.ParseFromArray(frame.msg.data(), frame.msg.size());
     if (req.msg.has_commandbytes()) {
@@ -86,77 +100,312 @@ bool CoroutineClient::manage(Frame &frame) noexcept {
         DLOG(INFO) << "K< VAL size " << req.value.size();
 
         cnxid_ = req.cmd.header().connectionid();
-
-        auto seqid = req.cmd.header().acksequence();
-        auto cb = [seqid](const std::shared_ptr<PendingExchange> &ex) -> bool {
-            return seqid == ex->Sequence();
-        };
-        auto it = std::find_if(pending_.begin(), pending_.end(), cb);
-        if (it != pending_.end()) {
-            (*it)->ManageReply(req);
-            (*it)->Signal();
-            pending_.erase(it);
+        last_activity_ = mill_now();
+
+        // The banner and the GETLOG replies may carry the device's limits
+        if (req.cmd.body().getlog().has_limits())
+            apply_limits(req.cmd.body().getlog().limits());
+
+        auto pe = pending_.Take(req.cmd.header().acksequence());
+        if (pe != nullptr) {
+            health_->Success();
+            latencies_[static_cast<unsigned int>(pe->Class())].Record(
+                    monotonic_usec() - pe->SentAt());
+            if (pe == probe_pending_.lock())
+                probe_pending_.reset();
+            // The small replies mostly measure the network
+            if (pe->Class() == RequestClass::SmallRead) {
+                rtt_.Sample(monotonic_usec() - pe->SentAt());
+                DLOG(INFO) << "K< rtt " << url_ << " srtt=" << rtt_.Srtt()
+                           << "us rttvar=" << rtt_.RttVar() << "us";
+            }
+            retire(*pe);
+            waiting_.ObserveReply(pe->Class(),
+                                  frame.msg.size() + req.value.size());
+            pe->ManageReply(req);
+            pe->Signal();
         }
     }
 
     return true;
 }
 
-bool CoroutineClient::forward(Frame &frame) noexcept {
-    uint8_t hdr[9] = {'F', 0, 0, 0, 0, 0, 0, 0, 0};
-    *((uint32_t *) (hdr + 1)) = ::htonl(frame.msg.size());
-    *((uint32_t *) (hdr + 5)) = ::htonl(frame.val.size());
-    struct iovec iov[] = {
-            BUFLEN_IOV(hdr, 9),
-            BUFLEN_IOV(frame.msg.data(), frame.msg.size()),
-            BUFLEN_IOV(frame.val.data(), frame.val.size())
+void CoroutineClient::apply_limits(
+        const proto::Command_GetLog_Limits &limits) noexcept {
+    if (limits.has_maxkeysize())
+        limits_.max_key_size = limits.maxkeysize();
+    if (limits.has_maxvaluesize())
+        limits_.max_value_size = limits.maxvaluesize();
+    if (limits.has_maxmessagesize())
+        limits_.max_message_size = limits.maxmessagesize();
+    if (limits.has_maxoutstandingreadrequests())
+        limits_.max_outstanding_reads = limits.maxoutstandingreadrequests();
+    if (limits.has_maxoutstandingwriterequests())
+        limits_.max_outstanding_writes = limits.maxoutstandingwriterequests();
+    limits_known_ = true;
+    reader_.SetMaxLength(std::max<uint32_t>(1024 * 1024, std::max(
+            limits_.max_value_size, limits_.max_message_size)));
+    DLOG(INFO) << "K< limits key=" << limits_.max_key_size
+               << " value=" << limits_.max_value_size
+               << " msg=" << limits_.max_message_size
+               << " reads=" << limits_.max_outstanding_reads
+               << " writes=" << limits_.max_outstanding_writes;
+}
+
+bool CoroutineClient::admit(const PendingExchange &pe) const noexcept {
+    if (pe.IsWrite())
+        return limits_.max_outstanding_writes == 0
+               || inflight_writes_ < limits_.max_outstanding_writes;
+    return limits_.max_outstanding_reads == 0
+           || inflight_reads_ < limits_.max_outstanding_reads;
+}
+
+void CoroutineClient::retire(PendingExchange &pe) noexcept {
+    pe.Release();
+    waiting_.Done(pe);
+    if (pe.IsWrite())
+        --inflight_writes_;
+    else
+        --inflight_reads_;
+    // Wake the producer up if it stopped on a full class
+    if (stalled_ && !waiting_.Empty()) {
+        stalled_ = false;
+        kick();
+    }
+}
+
+void CoroutineClient::expire(int64_t now) noexcept {
+    if (now < next_sweep_)
+        return;
+    next_sweep_ = now + 250;
+
+    std::vector<std::shared_ptr<PendingExchange>> expired;
+    pending_.Expire(now, expired);
+    bool slow = false;
+    for (auto &pe: expired) {
+        DLOG(INFO) << "K< seq " << pe->Sequence() << " expired";
+        if (pe == probe_pending_.lock()) {
+            // Nothing came back: the connection is probably half-open
+            probe_pending_.reset();
+            health_->Failure();
+            ::shutdown(sock_.fileno(), SHUT_RDWR);
+        } else {
+            slow = true;
+        }
+        retire(*pe);
+        pe->Fail(proto::Command_Status_StatusCode_EXPIRED, "no reply");
+    }
+    // A slow reply doesn't tell that the drive is down, a NOOP checks it
+    if (slow)
+        probe(now, true);
+    expire_waiting(now);
+}
+
+int64_t CoroutineClient::reply_timeout(RequestClass c) const noexcept {
+    // A small read and a large write don't take the same time
+    const auto &latencies = latencies_[static_cast<unsigned int>(c)];
+    if (latencies.Count() < min_latency_samples)
+        return timeout_;
+    // Far enough in the tail to be a loss rather than a slow reply, and
+    // never below what the network alone may take
+    const int64_t p99 = latencies.Percentile(0.99) / 1000;
+    const int64_t rto = rtt_.Rto() / 1000;
+    return std::min(timeout_,
+                    std::max({min_reply_timeout, 2 * rto, 3 * p99 + 50}));
+}
+
+int64_t CoroutineClient::deadline_for(const PendingExchange &pe,
+                                      int64_t now) const noexcept {
+    const auto dl = pe.RequestedDeadline();
+    return dl > 0 ? dl : now + reply_timeout(pe.Class());
+}
+
+void CoroutineClient::probe(int64_t now, bool force) noexcept {
+    if (!probe_pending_.expired())
+        return;
+    const auto due = health_->IsDown() ? next_probe_
+                                       : last_activity_ + keepalive_delay;
+    if (!force && now < due)
+        return;
+    next_probe_ = now + 1000;
+    // A single slow reply must not break an idle connection
+    probe_.SetDeadline(now + timeout_);
+    auto pe = prepare(&probe_);
+    probe_pending_ = pe;
+    waiting_.PushFront(pe);
+    kick();
+}
+
+void CoroutineClient::fail_waiting(proto::Command_Status_StatusCode code,
+                                   const char *why) noexcept {
+    std::vector<std::shared_ptr<PendingExchange>> failed;
+    waiting_.Expire(-1, failed);
+    for (auto &pe: failed) {
+        pe->Release();
+        pe->Fail(code, why);
+    }
+}
+
+void CoroutineClient::expire_waiting(int64_t now) noexcept {
+    std::vector<std::shared_ptr<PendingExchange>> expired;
+    waiting_.Expire(now, expired);
+    for (auto &pe: expired) {
+        DLOG(INFO) << "K> exchange expired before its sending";
+        pe->Release();
+        pe->Fail(proto::Command_Status_StatusCode_EXPIRED, "not sent");
+    }
+}
+
+void CoroutineClient::requeue() noexcept {
+    std::vector<std::shared_ptr<PendingExchange>> lost;
+    pending_.Expire(INT64_MAX, lost);
+    inflight_reads_ = inflight_writes_ = 0;
+    waiting_.ResetInflight();
+    stalled_ = false;
+
+    // Replay in the original order, before the exchanges not sent yet.
+    // They get new sequence numbers when sent again.
+    std::sort(lost.begin(), lost.end(),
+              [](const std::shared_ptr<PendingExchange> &p0,
+                 const std::shared_ptr<PendingExchange> &p1) -> bool {
+                  return p0->Sequence() < p1->Sequence();
+              });
+    for (auto it = lost.rbegin(); it != lost.rend(); ++it) {
+        auto &pe = *it;
+        // The next banner tells if the limits must be asked again, and
+        // if the drive must be probed
+        if (pe == limits_pending_.lock()) {
+            limits_pending_.reset();
+            continue;
+        }
+        if (pe == probe_pending_.lock()) {
+            probe_pending_.reset();
+            continue;
+        }
+        if (pe->IsIdempotent() && pe->Attempts() < max_attempts) {
+            DLOG(INFO) << "K> seq " << pe->Sequence() << " replayed";
+            const auto requested = pe->RequestedDeadline();
+            pe->SetDeadline(requested > 0 ? requested : mill_now() + timeout_);
+            waiting_.PushFront(pe);
+        } else {
+            DLOG(INFO) << "K> seq " << pe->Sequence() << " lost";
+            pe->Release();
+            pe->Fail(proto::Command_Status_StatusCode_CONNECTION_TERMINATED,
+                     "connection lost");
+        }
+    }
+}
+
+void CoroutineClient::pack_waiting(FrameBatch &batch) noexcept {
+    batch.count = 0;
+    batch.bytes = 0;
+    batch.deadline = 0;
+    const auto now = mill_now();
+    auto admitted = [this](const PendingExchange &pe) -> bool {
+        return admit(pe);
     };
-    return sock_.send(iov, 3, mill_now() + 5000);
+    while (!waiting_.Empty()
+           && batch.count < max_batch_frames
+           && batch.bytes < max_batch_bytes) {
+        // A full class only holds its own exchanges back
+        auto pe = waiting_.Pop(admitted);
+        if (pe == nullptr) {
+            stalled_ = true;
+            break;
+        }
+        if (pe->IsWrite())
+            ++inflight_writes_;
+        else
+            ++inflight_reads_;
+        if (batch.frames.size() <= batch.count)
+            batch.frames.emplace_back();
+        auto &frame = batch.frames[batch.count++];
+        const auto dl = deadline_for(*pe, now);
+        pe->SetSequence(seqid_++);
+        auto req = pe->MakeRequest();
+        packer_.Pack(*req, cnxid_, pe->Priority(), std::max<int64_t>(1, dl - now),
+                     frame);
+        batch.bytes += 9 + frame.msg.size() + frame.val.size();
+        if (batch.requests.size() < batch.count)
+            batch.requests.resize(batch.count);
+        batch.requests[batch.count - 1] = req;
+        if (batch.exchanges.size() < batch.count)
+            batch.exchanges.resize(batch.count);
+        batch.exchanges[batch.count - 1] = pe;
+        pe->Sent(req, monotonic_usec());
+        pe->SetDeadline(dl);
+        batch.deadline = std::max(batch.deadline, dl);
+        pending_.Insert(std::move(pe));
+    }
 }
 
-int CoroutineClient::pack(std::shared_ptr<Request> &req,
-                                 Frame &frame) noexcept {
-    assert (req != nullptr);
-
-    // Finish the command
-    auto h = req->cmd.mutable_header();
-    h->set_priority(proto::Command_Priority::Command_Priority_NORMAL);
-    h->set_clusterversion(0);
-    h->set_connectionid(cnxid_);
-    h->set_timeout(1000);
-
-    // Finish the message
-    req->msg.set_commandbytes(req->cmd.SerializeAsString());
-    auto hmac = compute_sha1_hmac("asdfasdf", req->msg.commandbytes());
-    req->msg.set_authtype(proto::Message_AuthType::Message_AuthType_HMACAUTH);
-    req->msg.mutable_hmacauth()->set_identity(1);
-    req->msg.mutable_hmacauth()->set_hmac(hmac.data(), hmac.size());
-
-    DLOG(INFO) << "K> CMD " << req->cmd.ShortDebugString();
-    DLOG(INFO) << "K> VAL size " << req->value.size();
-
-    // Serialize the message
-    frame.msg.clear();
-    frame.msg.resize(req->msg.ByteSize());
-    req->msg.SerializeToArray(frame.msg.data(), frame.msg.size());
-    frame.val.clear();
-    frame.val.swap(req->value);
-    return 0;
+bool CoroutineClient::forward(FrameBatch &batch) noexcept {
+    batch.headers.resize(batch.count);
+    batch.iov.clear();
+    for (unsigned int i = 0; i < batch.count; ++i) {
+        auto &frame = batch.frames[i];
+        auto &hdr = batch.headers[i];
+        hdr[0] = 'F';
+        *((uint32_t *) (hdr.data() + 1)) = ::htonl(frame.msg.size());
+        *((uint32_t *) (hdr.data() + 5)) = ::htonl(frame.val.size());
+        batch.iov.push_back(BUFLEN_IOV(hdr.data(), hdr.size()));
+        batch.iov.push_back(BUFLEN_IOV(frame.msg.data(), frame.msg.size()));
+        if (!frame.val.empty())
+            batch.iov.push_back(BUFLEN_IOV(frame.val.data(), frame.val.size()));
+    }
+
+    // The batch is useless once all its exchanges have expired. But a frame
+    // partially sent breaks the connection, so leave it a minimal delay.
+    const auto dl = std::max(batch.deadline, mill_now() + min_send_delay);
+    bool rc = sock_.send(batch.iov.data(), batch.iov.size(), dl);
+    const auto now = mill_now();
+    last_activity_ = now;
+
+    // The delay for the reply starts once the whole batch has left
+    const auto now_usec = monotonic_usec();
+    for (unsigned int i = 0; i < batch.count; ++i) {
+        auto &pe = batch.exchanges[i];
+        if (pending_.Holds(*pe)) {
+            pe->SetSentAt(now_usec);
+            pending_.SetDeadline(*pe, deadline_for(*pe, now));
+        }
+    }
+
+    // Give the values back to their request, for a possible replay. Those
+    // of the exchanges completed meanwhile are not needed anymore.
+    for (unsigned int i = 0; i < batch.count; ++i) {
+        if (pending_.Holds(*batch.exchanges[i]))
+            batch.requests[i]->value.swap(batch.frames[i].val);
+        else if (!batch.frames[i].val.empty())
+            BufferPool::Default().Release(batch.frames[i].val);
+        batch.frames[i].val.clear();
+        batch.requests[i].reset();
+        batch.exchanges[i].reset();
+    }
+    return rc;
 }
 
 coroutine void CoroutineClient::run_agent_consumer(chan done) noexcept {
 
     assert (sock_.fileno() < 0);
+    reader_.Reset();
+    broken_ = false;
+    int64_t connect_deadline = mill_now() + 1000;
     int64_t handshake_deadline = mill_now() + 5000;
 
     // Wait for an established connection
-    if (0 > (sock_.connect(url_)))
+    if (!sock_.connect(url_)) {
+        health_->Failure();
         goto out;
+    }
+    sock_.setopt(IPPROTO_TCP, TCP_NODELAY, 1);
 
     while (running_) {
-        int evt = fdwait(sock_.fileno(), FDW_OUT | FDW_IN, handshake_deadline);
-        if (evt & FDW_ERR)
+        int evt = fdwait(sock_.fileno(), FDW_OUT | FDW_IN, connect_deadline);
+        if (evt == 0 || (evt & FDW_ERR)) {
+            health_->Failure();
             goto out;
+        }
         if (evt & FDW_OUT)
             break;
     }
@@ -164,24 +413,41 @@ coroutine void CoroutineClient::run_agent_consumer(chan done) noexcept {
     // wait for a banner
     while (running_) {
         Frame banner;
-        int err = recv(banner, handshake_deadline);
+        int err = reader_.Read(banner, handshake_deadline);
         if (err == 0) {
+            Request req;
+            req.msg.ParseFromArray(banner.msg.data(), banner.msg.size());
+            req.cmd.ParseFromString(req.msg.commandbytes());
             manage(banner);
+            backoff_ = 0;
+            // Ask explicitly for the limits that the banner didn't carry.
+            // The query goes first, before the exchanges already queued.
+            if (!req.cmd.body().getlog().has_limits()
+                && limits_pending_.expired()) {
+                auto pe = prepare(&limits_query_);
+                limits_pending_ = pe;
+                waiting_.PushFront(pe);
+            }
             break;
         }
-        if (err != EAGAIN)
+        if (err != EAGAIN || mill_now() >= handshake_deadline) {
+            health_->Failure();
             goto out;
+        }
     }
 
     if (running_) {
         // Ok, start the producer coroutine
         chan from_producer = chmake(int, 0);
         mill_go(run_agent_producer(from_producer));
+        if (!waiting_.Empty())
+            kick();
+        probe(mill_now());
 
         // consume frames from the device
         while (running_) {
             Frame frame;
-            int err = recv(frame, mill_now() + 1000);
+            int err = reader_.Read(frame, mill_now() + 1000);
             if (err == 0) {
                 if (!manage(frame)) {
                     DLOG(INFO) << "Frame management error";
@@ -190,8 +456,12 @@ coroutine void CoroutineClient::run_agent_consumer(chan done) noexcept {
             }
             else if (err != EAGAIN)
                 break;
+            expire(mill_now());
+            probe(mill_now());
         }
         DLOG(INFO) << "K< waiting for the producer";
+        broken_ = true;
+        chs(to_agent_, int, SIGNAL_AGENT_DATA);
         (void) chr(from_producer, int);
     }
 
@@ -201,10 +471,8 @@ coroutine void CoroutineClient::run_agent_consumer(chan done) noexcept {
 }
 
 coroutine void CoroutineClient::run_agent_producer(chan done) noexcept {
-    Frame frame;
-    while (running_) {
-        frame.msg.clear();
-        frame.val.clear();
+    FrameBatch batch;
+    while (running_ && !broken_) {
         mill_choose {
                 mill_in(to_agent_, int, sig):
                         if (SIGNAL_AGENT_STOP == sig) {
@@ -212,14 +480,17 @@ coroutine void CoroutineClient::run_agent_producer(chan done) noexcept {
                             ::shutdown(sock_.fileno(), SHUT_RDWR);
                             break;
                         } else {
-                            std::shared_ptr<PendingExchange> pe(
-                                    waiting_.front());
-                            waiting_.pop();
-                            auto spe = pe->MakeRequest();
-                            pack(spe, frame);
-                            pending_.emplace_back(std::move(pe));
-                            if (!forward(frame)) {
-                                DLOG(INFO) << "K> forward error";
+                            kicked_ = false;
+                            // Drain the queue, several frames per syscall
+                            while (!broken_ && !waiting_.Empty()) {
+                                pack_waiting(batch);
+                                if (batch.count == 0)
+                                    break;
+                                if (!forward(batch)) {
+                                    DLOG(INFO) << "K> forward error";
+                                    ::shutdown(sock_.fileno(), SHUT_RDWR);
+                                    break;
+                                }
                             }
                         }
                 mill_deadline(mill_now() + 1000):
@@ -237,24 +508,135 @@ coroutine void CoroutineClient::run_agents() noexcept {
         (void) chr(from_consumer, int);
         sock_.close();
         chclose(from_consumer);
-        if (running_) msleep(mill_now() + 500);
+        requeue();
+        if (health_->IsDown())
+            fail_waiting(proto::Command_Status_StatusCode_REMOTE_CONNECTION_ERROR,
+                         "drive down");
+        else
+            expire_waiting(mill_now());
+        if (running_) {
+            // Back off exponentially while the device stays unreachable
+            backoff_ = std::min(max_backoff, std::max(min_backoff, backoff_ * 2));
+            msleep(mill_now() + backoff_);
+        }
     }
+    // Nobody will send the exchanges left
+    fail_waiting(proto::Command_Status_StatusCode_CONNECTION_TERMINATED,
+                 "client closed");
     chs(stopped_, int, SIGNAL_AGENT_STOP);
 }
 
 std::shared_ptr<Sync> CoroutineClient::Start(Exchange *ei) noexcept {
+    return Start(ei, nullptr, 0);
+}
+
+std::shared_ptr<Sync> CoroutineClient::Start(
+        Exchange *ei, std::shared_ptr<CompletionQueue> cq,
+        uint64_t tag) noexcept {
     // Ensure the agents are running
     if (!running_) {
         running_ = true;
         mill_go(run_agents());
     }
 
-    // push the rpc down
-    PendingExchange *ex = new PendingExchange(ei);
-    ex->SetSequence(seqid_++);
+    // push the rpc down, unless the drive is known to be down
+    auto shex = prepare(ei);
+    if (cq != nullptr)
+        shex->SetCompletion(cq, tag);
+    if (health_->IsDown()) {
+        shex->Fail(proto::Command_Status_StatusCode_REMOTE_CONNECTION_ERROR,
+                   "drive down");
+        return shex;
+    }
+    waiting_.PushBack(shex);
+    kick();
+    return shex;
+}
+
+std::shared_ptr<SyncGroup> CoroutineClient::StartMany(
+        const std::vector<Exchange *> &exs) noexcept {
+    if (!running_) {
+        running_ = true;
+        mill_go(run_agents());
+    }
+
+    std::shared_ptr<SyncGroup> group(new SyncGroup);
+    for (auto ei: exs) {
+        auto shex = prepare(ei);
+        if (health_->IsDown())
+            shex->Fail(proto::Command_Status_StatusCode_REMOTE_CONNECTION_ERROR,
+                       "drive down");
+        else
+            waiting_.PushBack(shex);
+        group->Add(shex);
+    }
+    if (!exs.empty())
+        kick();
+    return group;
+}
 
-    std::shared_ptr<PendingExchange> shex(ex);
-    waiting_.push(shex);
+void CoroutineClient::kick() noexcept {
+    if (kicked_)
+        return;
+    kicked_ = true;
     chs(to_agent_, int, SIGNAL_AGENT_DATA);
-    return shex;
+}
+
+std::shared_ptr<PendingExchange> CoroutineClient::prepare(
+        Exchange *ei) noexcept {
+    // The exchanges and their shared state are recycled
+    auto ex = std::allocate_shared<PendingExchange>(
+            PoolAllocator<PendingExchange>(), ei);
+    // Until it is sent, the exchange may wait behind others: the delay
+    // derived from the latencies only starts at the sending.
+    const auto requested = ex->RequestedDeadline();
+    ex->SetDeadline(requested > 0 ? requested : mill_now() + timeout_);
+
+    // Classify the exchange for the admission control, the replays and
+    // the scheduling. A PUT is replayed only when it is conditioned by a
+    // version.
+    const auto req = ei->MakeRequest();
+    const auto &cmd = req->cmd;
+    switch (cmd.header().messagetype()) {
+        case proto::Command_MessageType_PUT:
+            ex->SetWrite(true);
+            ex->SetIdempotent(!cmd.body().keyvalue().force()
+                              && cmd.body().keyvalue().has_dbversion());
+            break;
+        case proto::Command_MessageType_DELETE:
+            ex->SetWrite(true);
+            ex->SetIdempotent(true);
+            break;
+        case proto::Command_MessageType_FLUSHALLDATA:
+            ex->SetWrite(true);
+            ex->SetIdempotent(false);
+            break;
+        case proto::Command_MessageType_GET:
+        case proto::Command_MessageType_GETNEXT:
+        case proto::Command_MessageType_GETPREVIOUS:
+        case proto::Command_MessageType_GETKEYRANGE:
+        case proto::Command_MessageType_GETVERSION:
+        case proto::Command_MessageType_GETLOG:
+        case proto::Command_MessageType_NOOP:
+            ex->SetWrite(false);
+            ex->SetIdempotent(true);
+            break;
+        default:
+            ex->SetWrite(false);
+            ex->SetIdempotent(false);
+    }
+
+    RequestClass rc;
+    if (ex->Priority() <= proto::Command_Priority_LOWER)
+        rc = RequestClass::Background;
+    else if (ex->IsWrite())
+        rc = RequestClass::Write;
+    else if (cmd.header().messagetype() == proto::Command_MessageType_GET
+             || cmd.header().messagetype() == proto::Command_MessageType_GETNEXT
+             || cmd.header().messagetype() == proto::Command_MessageType_GETPREVIOUS)
+        rc = RequestClass::LargeRead;
+    else
+        rc = RequestClass::SmallRead;
+    ex->SetClass(rc, waiting_.EstimateCost(rc, req->value.size()));
+    return ex;
 }
@@ -10,15 +10,26 @@
 #include <cstdint>
 #include <string>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <cassert>
+#include <array>
+#include <sys/uio.h>
 #include <utils/utils.h>
 #include <utils/MillSocket.h>
 #include <kinetic.pb.h>
 #include <oio/kinetic/rpc/Exchange.h>
 #include <oio/kinetic/rpc/Request.h>
+#include <oio/kinetic/rpc/GetLog.h>
+#include <oio/kinetic/rpc/Noop.h>
 #include <oio/kinetic/client/ClientInterface.h>
 #include <oio/kinetic/client/PendingExchange.h>
+#include <oio/kinetic/client/PendingTable.h>
+#include <oio/kinetic/client/Scheduler.h>
+#include <oio/kinetic/client/FrameReader.h>
+#include <oio/kinetic/client/Packer.h>
+#include <oio/kinetic/client/DriveHealth.h>
+#include <oio/kinetic/client/RttEstimator.h>
+#include <oio/kinetic/client/LatencyHistogram.h>
 
 #define SIGNAL_AGENT_STOP 0
 #define SIGNAL_AGENT_DATA 1
@@ -29,13 +40,19 @@ namespace oio {
 namespace kinetic {
 namespace client {
 
-struct Frame {
-    std::vector<uint8_t> msg;
-    std::vector<uint8_t> val;
-
-    Frame() : msg(), val() { }
-
-    ~Frame() { }
+/* Frames packed together, then sent with a single writev() */
+struct FrameBatch {
+    std::vector<Frame> frames;
+    std::vector<std::shared_ptr<oio::kinetic::rpc::Request>> requests;
+    std::vector<std::shared_ptr<PendingExchange>> exchanges;
+    std::vector<std::array<uint8_t, 9>> headers;
+    std::vector<struct iovec> iov;
+    unsigned int count;
+    size_t bytes;
+    int64_t deadline; // the latest of the frames
+
+    FrameBatch() : frames(), requests(), exchanges(), headers(), iov(),
+                   count{0}, bytes{0}, deadline{0} { }
 };
 
 namespace proto = ::com::seagate::kinetic::proto;
@@ -45,11 +62,34 @@ class CoroutineClient : public ClientInterface {
   private:
     std::string url_;
     MillSocket sock_;
+    FrameReader reader_;
+    Packer packer_;
     int64_t cnxid_;
     uint64_t seqid_;
 
-    std::queue<std::shared_ptr<PendingExchange>> waiting_;
-    std::vector<std::shared_ptr<PendingExchange>> pending_;
+    Scheduler waiting_;
+    PendingTable pending_;
+    oio::kinetic::rpc::Request reply_; // reused by each received frame
+    DeviceLimits limits_;
+    bool limits_known_; // told by the device
+    oio::kinetic::rpc::GetLog limits_query_;
+    std::weak_ptr<PendingExchange> limits_pending_; // the query not answered
+    std::shared_ptr<DriveHealth> health_;
+    oio::kinetic::rpc::Noop probe_;
+    std::weak_ptr<PendingExchange> probe_pending_; // the NOOP not answered
+    int64_t next_probe_;
+    int64_t last_activity_; // last frame sent or received, in ms
+    RttEstimator rtt_; // measured with the small reads, the NOOP included
+    // Of the replies, by class of exchange
+    std::array<LatencyHistogram, nb_request_classes> latencies_;
+    unsigned int inflight_reads_;
+    unsigned int inflight_writes_;
+    bool stalled_; // the producer waits for in-flight exchanges to finish
+    bool kicked_; // a signal is already on its way to the producer
+    bool broken_; // the connection is lost, the producer must exit
+    int64_t backoff_; // delay before the next connection attempt, in ms
+    int64_t timeout_; // max delay for a reply, in ms
+    int64_t next_sweep_;
     struct mill_chan *to_agent_; // <int>
     struct mill_chan *stopped_;
     bool running_;
@@ -67,15 +107,61 @@ class CoroutineClient : public ClientInterface {
 
     std::shared_ptr<Sync> Start(oio::kinetic::rpc::Exchange *ex) noexcept;
 
-    // returns errno
-    int recv(Frame &frame, int64_t dl) noexcept;
+    std::shared_ptr<Sync> Start(oio::kinetic::rpc::Exchange *ex,
+                                std::shared_ptr<CompletionQueue> cq,
+                                uint64_t tag) noexcept;
+
+    std::shared_ptr<SyncGroup> StartMany(
+            const std::vector<oio::kinetic::rpc::Exchange *> &exs) noexcept;
+
+    // Wakes the producer up, unless a wakeup is already pending
+    void kick() noexcept;
 
     bool manage(Frame &frame) noexcept;
 
-    bool forward(Frame &frame) noexcept;
+    // Packs the waiting exchanges in the batch, until it is full
+    void pack_waiting(FrameBatch &batch) noexcept;
+
+    bool forward(FrameBatch &batch) noexcept;
+
+    // Fails the in-flight exchanges whose deadline has been reached
+    void expire(int64_t now) noexcept;
+
+    // Wraps and classifies an exchange. Its sequence number is only given
+    // when it is packed, so that they increase on the wire.
+    std::shared_ptr<PendingExchange> prepare(
+            oio::kinetic::rpc::Exchange *ex) noexcept;
+
+    // Sends a NOOP to a drive known to be down, at most once per second,
+    // or on a connection idle for a while, to check it and sample the RTT.
+    // With `force`, after replies missing, at once.
+    void probe(int64_t now, bool force = false) noexcept;
+
+    // Delay given to an exchange of the class without deadline, in ms
+    int64_t reply_timeout(RequestClass c) const noexcept;
+
+    // The deadline of an exchange sent now
+    int64_t deadline_for(const PendingExchange &pe, int64_t now) const noexcept;
+
+    // Fails all the queued exchanges
+    void fail_waiting(proto::Command_Status_StatusCode code,
+                      const char *why) noexcept;
 
-    // Packs req in frame, and return errno
-    int pack(std::shared_ptr<oio::kinetic::rpc::Request> &req, Frame &frame) noexcept;
+    // Fails the queued exchanges whose deadline has been reached
+    void expire_waiting(int64_t now) noexcept;
+
+    // After a connection loss, queues the in-flight exchanges that can be
+    // replayed and fails the others.
+    void requeue() noexcept;
+
+    // Accounts the end of an in-flight exchange
+    void retire(PendingExchange &pe) noexcept;
+
+    void apply_limits(
+            const proto::Command_GetLog_Limits &limits) noexcept;
+
+    // Tells if the admission control lets the exchange go to the device
+    bool admit(const PendingExchange &pe) const noexcept;
 
     NOINLINE void run_agent_consumer(struct mill_chan *done) noexcept;
 
@@ -86,9 +172,30 @@ class CoroutineClient : public ClientInterface {
   public:
     ~CoroutineClient() noexcept;
 
-    CoroutineClient(const std::string &u) noexcept;
+    CoroutineClient(const std::string &u,
+                    const Credentials &c = Credentials(),
+                    std::shared_ptr<DriveHealth> h = nullptr) noexcept;
 
     std::string debug_string() const noexcept;
+
+    // Weights and caps of the classes of exchanges
+    void Scheduling(const SchedulerConfig &cfg) noexcept {
+        waiting_.Configure(cfg);
+    }
+
+    // Limits advertised by the device, the defaults until it is connected
+    DeviceLimits Limits() const noexcept { return limits_; }
+
+    bool LimitsKnown() const noexcept { return limits_known_; }
+
+    bool IsDown() const noexcept { return health_->IsDown(); }
+
+    int64_t Latency() const noexcept { return rtt_.Srtt(); }
+
+    const RttEstimator &Rtt() const noexcept { return rtt_; }
+
+    // Number of exchanges queued or waiting for a reply
+    size_t Load() const noexcept { return waiting_.Size() + pending_.Size(); }
 };
 
 } // namespace client
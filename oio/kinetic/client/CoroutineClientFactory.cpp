@@ -7,6 +7,7 @@
 #include "ClientInterface.h"
 #include "CoroutineClient.h"
 #include "CoroutineClientFactory.h"
+#include "StripedClient.h"
 
 using namespace oio::kinetic::client;
 
@@ -16,8 +17,19 @@ CoroutineClientFactory::Get(const std::string &url) noexcept {
     if (it != cnx.end())
         return it->second;
 
-    CoroutineClient *client = new CoroutineClient(url);
-    std::shared_ptr<ClientInterface> shared(client);
+    auto itc = drive_credentials.find(url);
+    const auto &creds = itc != drive_credentials.end() ? itc->second : credentials;
+
+    std::shared_ptr<ClientInterface> shared;
+    if (stripes > 1) {
+        auto sc = new StripedClient(url, stripes, creds);
+        sc->Scheduling(scheduling);
+        shared.reset(sc);
+    } else {
+        auto cc = new CoroutineClient(url, creds);
+        cc->Scheduling(scheduling);
+        shared.reset(cc);
+    }
     cnx[url] = shared;
     return shared;
 }
@@ -7,9 +7,11 @@
 #ifndef OIO_KINETIC_CLIENT_COROUTINECLIENTFACTORY_H
 #define OIO_KINETIC_CLIENT_COROUTINECLIENTFACTORY_H
 
+#include <map>
 #include <memory>
 #include <string>
 #include "ClientInterface.h"
+#include "Scheduler.h"
 
 namespace oio {
 namespace kinetic {
@@ -17,14 +19,41 @@ namespace client {
 
 class CoroutineClientFactory : public ClientFactory {
   public:
-    CoroutineClientFactory() noexcept: cnx() { }
+    CoroutineClientFactory() noexcept:
+            cnx(), stripes{1}, credentials(), drive_credentials(),
+            scheduling() { }
+
+    // Each drive will be reached through `nb` connections
+    CoroutineClientFactory(unsigned int nb) noexcept:
+            cnx(), stripes{nb}, credentials(), drive_credentials(),
+            scheduling() { }
 
     ~CoroutineClientFactory() noexcept { }
 
+    // Credentials used for the drives without specific ones
+    void DefaultCredentials(const Credentials &c) noexcept {
+        credentials = c;
+    }
+
+    // Credentials used for the connections to `url` only
+    void DriveCredentials(const std::string &url,
+                          const Credentials &c) noexcept {
+        drive_credentials[url] = c;
+    }
+
+    // Weights and caps of the classes of exchanges, on each connection
+    void Scheduling(const SchedulerConfig &cfg) noexcept {
+        scheduling = cfg;
+    }
+
     std::shared_ptr<ClientInterface> Get(const std::string &url) noexcept;
 
   private:
     std::map<std::string, std::shared_ptr<ClientInterface>> cnx;
+    unsigned int stripes;
+    Credentials credentials;
+    std::map<std::string, Credentials> drive_credentials;
+    SchedulerConfig scheduling;
 };
 
 } // namespace client
@@ -0,0 +1,23 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <glog/logging.h>
+#include "DriveHealth.h"
+
+using oio::kinetic::client::DriveHealth;
+
+void DriveHealth::Success() noexcept {
+    if (IsDown())
+        LOG(INFO) << "Drive " << url_ << " back up";
+    failures_ = 0;
+}
+
+void DriveHealth::Failure() noexcept {
+    if (++failures_ == threshold_) {
+        LOG(WARNING) << "Drive " << url_ << " down after "
+                     << failures_ << " failures";
+    }
+}
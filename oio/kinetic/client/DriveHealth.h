@@ -0,0 +1,45 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_DRIVEHEALTH_H
+#define OIO_KINETIC_CLIENT_DRIVEHEALTH_H
+
+#include <string>
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* Circuit breaker on a drive. It opens after several failures in a row
+ * (connection errors, handshake timeouts, probes without reply) and closes
+ * at the first reply. A slow reply only triggers a probe. While it is open,
+ * the clients fail the exchanges at once and only probe the drive. Shared
+ * by all the connections to the same drive: the factory gives a single
+ * client per drive, striped or not. */
+class DriveHealth {
+  public:
+    DriveHealth(const std::string &url) noexcept:
+            url_(url), failures_{0}, threshold_{3} { }
+
+    ~DriveHealth() noexcept { }
+
+    void Success() noexcept;
+
+    void Failure() noexcept;
+
+    bool IsDown() const noexcept { return failures_ >= threshold_; }
+
+  private:
+    std::string url_;
+    unsigned int failures_; // in a row
+    unsigned int threshold_;
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_DRIVEHEALTH_H
@@ -0,0 +1,124 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <netinet/in.h>
+
+#include <utils/BufferPool.h>
+#include "FrameReader.h"
+
+using oio::kinetic::client::Frame;
+using oio::kinetic::client::FrameReader;
+
+static constexpr size_t frame_header_size = 9;
+static constexpr size_t block_size = 64 * 1024;
+
+// Maps a MillSocket::read() failure to an errno value
+static int _read_error(ssize_t rc) noexcept {
+    if (rc == 0)
+        return EAGAIN;
+    if (rc == -2)
+        return ECONNRESET;
+    return (errno != 0 && errno != EAGAIN) ? errno : EIO;
+}
+
+FrameReader::FrameReader(MillSocket &s) noexcept:
+        sock_(s), buf_(block_size), head_{0}, tail_{0},
+        current_(), has_header_{false}, done_{0},
+        max_length_{1024 * 1024} { }
+
+FrameReader::~FrameReader() noexcept { }
+
+void FrameReader::Reset() noexcept {
+    head_ = tail_ = 0;
+    has_header_ = false;
+    done_ = 0;
+    current_.msg.clear();
+    current_.val.clear();
+}
+
+int FrameReader::fill(int64_t dl) noexcept {
+    if (head_ == tail_) {
+        head_ = tail_ = 0;
+    } else if (tail_ == buf_.size()) {
+        ::memmove(buf_.data(), buf_.data() + head_, available());
+        tail_ -= head_;
+        head_ = 0;
+    }
+
+    auto rc = sock_.read(buf_.data() + tail_, buf_.size() - tail_, dl);
+    if (rc <= 0)
+        return _read_error(rc);
+    tail_ += rc;
+    return 0;
+}
+
+int FrameReader::Read(Frame &frame, int64_t dl) noexcept {
+    if (!has_header_) {
+        while (available() < frame_header_size) {
+            int err = fill(dl);
+            if (err != 0)
+                return err;
+        }
+
+        const uint8_t *hdr = buf_.data() + head_;
+        if (hdr[0] != 'F')
+            return EBADMSG;
+        uint32_t lenmsg, lenval;
+        ::memcpy(&lenmsg, hdr + 1, sizeof(lenmsg));
+        ::memcpy(&lenval, hdr + 5, sizeof(lenval));
+        lenmsg = ::ntohl(lenmsg);
+        lenval = ::ntohl(lenval);
+        if (lenval > max_length_ || lenmsg > max_length_)
+            return E2BIG;
+
+        head_ += frame_header_size;
+        current_.msg.resize(lenmsg);
+        if (current_.val.capacity() < lenval)
+            current_.val = BufferPool::Default().Acquire(lenval);
+        current_.val.resize(lenval);
+        has_header_ = true;
+        done_ = 0;
+    }
+
+    const size_t lenmsg = current_.msg.size();
+    const size_t total = lenmsg + current_.val.size();
+    while (done_ < total) {
+        uint8_t *dst;
+        size_t want;
+        if (done_ < lenmsg) {
+            dst = current_.msg.data() + done_;
+            want = lenmsg - done_;
+        } else {
+            dst = current_.val.data() + (done_ - lenmsg);
+            want = total - done_;
+        }
+
+        if (available() > 0) {
+            const size_t local = std::min(want, available());
+            ::memcpy(dst, buf_.data() + head_, local);
+            head_ += local;
+            done_ += local;
+        } else if (want >= buf_.size() / 2) {
+            // Large enough to skip the intermediate buffer
+            auto rc = sock_.read(dst, want, dl);
+            if (rc <= 0)
+                return _read_error(rc);
+            done_ += rc;
+        } else {
+            int err = fill(dl);
+            if (err != 0)
+                return err;
+        }
+    }
+
+    has_header_ = false;
+    frame.msg.swap(current_.msg);
+    frame.val.swap(current_.val);
+    return 0;
+}
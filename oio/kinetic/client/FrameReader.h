@@ -0,0 +1,72 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_FRAMEREADER_H
+#define OIO_KINETIC_CLIENT_FRAMEREADER_H
+
+#include <cstdint>
+#include <vector>
+#include <utils/MillSocket.h>
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+struct Frame {
+    std::vector<uint8_t> msg;
+    std::vector<uint8_t> val;
+
+    Frame() : msg(), val() { }
+
+    ~Frame() { }
+};
+
+/* Decodes the Kinetic frames arriving on a socket. The bytes are read by large
+ * blocks and as many frames as possible are extracted from each block. The
+ * tail of a large frame is read directly in its final buffer. A frame
+ * interrupted by a timeout is resumed by the next call. */
+class FrameReader {
+  public:
+    FrameReader(MillSocket &s) noexcept;
+
+    ~FrameReader() noexcept;
+
+    // Returns 0 when a whole frame has been read, EAGAIN if the deadline
+    // expired before, or another errno value if the stream is unusable.
+    int Read(Frame &frame, int64_t dl) noexcept;
+
+    // Forget any buffered byte, e.g. after a reconnection
+    void Reset() noexcept;
+
+    // Frames with a larger message or value are rejected with E2BIG
+    void SetMaxLength(uint32_t l) noexcept { max_length_ = l; }
+
+  private:
+    FrameReader(const FrameReader &o) = delete;
+
+    FrameReader(FrameReader &&o) = delete;
+
+    size_t available() const noexcept { return tail_ - head_; }
+
+    int fill(int64_t dl) noexcept;
+
+  private:
+    MillSocket &sock_;
+    std::vector<uint8_t> buf_;
+    size_t head_, tail_;
+
+    // The frame being decoded
+    Frame current_;
+    bool has_header_;
+    size_t done_;
+    uint32_t max_length_;
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_FRAMEREADER_H
@@ -0,0 +1,64 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include "LatencyHistogram.h"
+
+using oio::kinetic::client::LatencyHistogram;
+
+// Number of samples between two halvings of the counts
+static constexpr uint64_t decay_period = 4096;
+
+static unsigned int _bucket(uint64_t v) noexcept {
+    if (v < 4)
+        return v;
+    const unsigned int e = 63 - __builtin_clzll(v);
+    return 4 + (e - 2) * 4 + ((v >> (e - 2)) & 3);
+}
+
+static int64_t _upper_bound(unsigned int idx) noexcept {
+    if (idx < 4)
+        return idx;
+    const unsigned int e = 2 + (idx - 4) / 4;
+    const uint64_t sub = (idx - 4) % 4;
+    return ((4 + sub + 1) << (e - 2)) - 1;
+}
+
+LatencyHistogram::LatencyHistogram() noexcept:
+        counts_(), total_{0}, since_decay_{0} {
+    counts_.fill(0);
+}
+
+void LatencyHistogram::Record(int64_t usec) noexcept {
+    if (usec < 0)
+        return;
+    auto idx = _bucket(usec);
+    if (idx >= nb_buckets)
+        idx = nb_buckets - 1;
+    ++counts_[idx];
+    ++total_;
+
+    if (++since_decay_ >= decay_period) {
+        since_decay_ = 0;
+        total_ = 0;
+        for (auto &c: counts_) {
+            c /= 2;
+            total_ += c;
+        }
+    }
+}
+
+int64_t LatencyHistogram::Percentile(double q) const noexcept {
+    if (total_ == 0)
+        return 0;
+    const uint64_t rank = static_cast<uint64_t>(q * total_ + 0.5);
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < nb_buckets; ++i) {
+        seen += counts_[i];
+        if (seen >= rank && seen > 0)
+            return _upper_bound(i);
+    }
+    return _upper_bound(nb_buckets - 1);
+}
@@ -0,0 +1,45 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_LATENCYHISTOGRAM_H
+#define OIO_KINETIC_CLIENT_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* Distribution of the latencies, in microseconds, with 4 buckets per power
+ * of 2 (i.e. at most 25% of error). The counts are halved regularly, so
+ * that the percentiles follow the recent behavior of the drive. */
+class LatencyHistogram {
+  public:
+    LatencyHistogram() noexcept;
+
+    ~LatencyHistogram() noexcept { }
+
+    void Record(int64_t usec) noexcept;
+
+    // Upper bound of the q-th quantile (0 < q <= 1), 0 without any sample
+    int64_t Percentile(double q) const noexcept;
+
+    uint64_t Count() const noexcept { return total_; }
+
+  private:
+    static constexpr unsigned int nb_buckets = 4 + 4 * 40;
+
+    std::array<uint32_t, nb_buckets> counts_;
+    uint64_t total_;
+    uint64_t since_decay_;
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_LATENCYHISTOGRAM_H
@@ -0,0 +1,88 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cstring>
+#include <glog/logging.h>
+#include "Packer.h"
+
+namespace proto = ::com::seagate::kinetic::proto;
+using oio::kinetic::rpc::Request;
+using oio::kinetic::client::Packer;
+using oio::kinetic::client::Credentials;
+using oio::kinetic::client::Frame;
+
+// Tags of the fields of a Message, with their wire type
+static constexpr uint8_t tag_authtype = (4 << 3) | 0;
+static constexpr uint8_t tag_hmacauth = (5 << 3) | 2;
+static constexpr uint8_t tag_hmacauth_identity = (1 << 3) | 0;
+static constexpr uint8_t tag_hmacauth_hmac = (2 << 3) | 2;
+static constexpr uint8_t tag_commandbytes = (7 << 3) | 2;
+
+static uint8_t *_varint(uint8_t *dst, uint64_t v) noexcept {
+    while (v >= 0x80) {
+        *dst++ = static_cast<uint8_t>(v | 0x80);
+        v >>= 7;
+    }
+    *dst++ = static_cast<uint8_t>(v);
+    return dst;
+}
+
+static void _append_varint(std::vector<uint8_t> &dst, uint64_t v) noexcept {
+    uint8_t buf[10];
+    dst.insert(dst.end(), buf, _varint(buf, v));
+}
+
+Packer::Packer(const Credentials &c) noexcept: hmac_(c.key), prefix_() {
+    std::vector<uint8_t> auth;
+    auth.push_back(tag_hmacauth_identity);
+    _append_varint(auth, static_cast<uint64_t>(c.identity));
+    auth.push_back(tag_hmacauth_hmac);
+    auth.push_back(HmacSha1::digest_size);
+
+    prefix_.push_back(tag_authtype);
+    _append_varint(prefix_, proto::Message_AuthType_HMACAUTH);
+    prefix_.push_back(tag_hmacauth);
+    _append_varint(prefix_, auth.size() + HmacSha1::digest_size);
+    prefix_.insert(prefix_.end(), auth.begin(), auth.end());
+    prefix_.resize(prefix_.size() + HmacSha1::digest_size);
+}
+
+Packer::~Packer() noexcept { }
+
+void Packer::Pack(Request &req, int64_t cnxid,
+                  proto::Command_Priority priority, int64_t timeout,
+                  Frame &frame) noexcept {
+    // Finish the command
+    auto h = req.cmd.mutable_header();
+    h->set_priority(priority);
+    h->set_clusterversion(0);
+    h->set_connectionid(cnxid);
+    h->set_timeout(timeout);
+
+    DLOG(INFO) << "K> CMD " << req.cmd.ShortDebugString();
+    DLOG(INFO) << "K> VAL size " << req.value.size();
+
+    // Lay the message out: prefix, commandBytes header, command
+    const size_t cmdlen = req.cmd.ByteSize();
+    uint8_t cmdhdr[11];
+    cmdhdr[0] = tag_commandbytes;
+    const size_t cmdhdrlen = _varint(cmdhdr + 1, cmdlen) - cmdhdr;
+
+    frame.msg.resize(prefix_.size() + cmdhdrlen + cmdlen);
+    uint8_t *p = frame.msg.data();
+    ::memcpy(p, prefix_.data(), prefix_.size());
+    uint8_t *hmac = p + prefix_.size() - HmacSha1::digest_size;
+    p += prefix_.size();
+    ::memcpy(p, cmdhdr, cmdhdrlen);
+    p += cmdhdrlen;
+    req.cmd.SerializeWithCachedSizesToArray(p);
+
+    // Sign the command where it lies
+    hmac_.Compute(p, cmdlen, hmac);
+
+    frame.val.clear();
+    frame.val.swap(req.value);
+}
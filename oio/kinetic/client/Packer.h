@@ -0,0 +1,49 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_PACKER_H
+#define OIO_KINETIC_CLIENT_PACKER_H
+
+#include <cstdint>
+#include <vector>
+#include <utils/Hmac.h>
+#include <oio/kinetic/rpc/Request.h>
+#include "ClientInterface.h"
+#include "FrameReader.h"
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* Turns a request into a signed frame, with the credentials of a
+ * connection. The command is serialized once, directly in the frame, behind
+ * an encoded Message whose fields are the same for all the frames of the
+ * connection but the HMAC and the length of the command. */
+class Packer {
+  public:
+    Packer(const Credentials &c) noexcept;
+
+    ~Packer() noexcept;
+
+    // The value of the request is moved into the frame. `timeout` is the
+    // delay (in ms) given to the drive to process the command.
+    void Pack(oio::kinetic::rpc::Request &req, int64_t cnxid,
+              ::com::seagate::kinetic::proto::Command_Priority priority,
+              int64_t timeout, Frame &frame) noexcept;
+
+  private:
+    Packer() = delete;
+
+    HmacSha1 hmac_;
+    // The encoded authType and hmacAuth, with a slot for the HMAC at the end
+    std::vector<uint8_t> prefix_;
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_PACKER_H
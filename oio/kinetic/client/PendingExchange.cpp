@@ -5,19 +5,48 @@
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
 #include <cstdint>
+#include <vector>
 #include <libmill.h>
 #include "PendingExchange.h"
 
 using oio::kinetic::client::PendingExchange;
 
+// The notification channels outlive the exchanges, for the next ones
+static constexpr size_t max_free_channels = 1024;
+static std::vector<chan> free_channels;
+
+static chan _channel_acquire() noexcept {
+    if (free_channels.empty())
+        return chmake(int, 1);
+    chan ch = free_channels.back();
+    free_channels.pop_back();
+    return ch;
+}
+
+static void _channel_release(chan ch) noexcept {
+    if (free_channels.size() >= max_free_channels) {
+        chclose(ch);
+        return;
+    }
+    // Consume the signal that nobody waited for
+    mill_choose {
+        mill_in(ch, int, sig):
+            (void) sig;
+        mill_otherwise:
+        mill_end
+    }
+    free_channels.push_back(ch);
+}
+
 PendingExchange::PendingExchange(oio::kinetic::rpc::Exchange *e) noexcept:
-        exchange_(e), notification_{nullptr} {
-    notification_ = chmake(int, 1);
+        exchange_(e), notification_{nullptr}, seqid_{0}, deadline_{0}, write_{false},
+        class_{RequestClass::SmallRead}, cost_{0}, cq_(), tag_{0}, idempotent_{false}, attempts_{0}, sent_usec_{0}, request_() {
+    notification_ = _channel_acquire();
 }
 
 PendingExchange::~PendingExchange() noexcept {
     assert(notification_ != nullptr);
-    chclose(notification_);
+    _channel_release(notification_);
 }
 
 void PendingExchange::SetSequence(int64_t s) noexcept {
@@ -30,9 +59,29 @@ int64_t PendingExchange::Sequence() const noexcept {
     return seqid_;
 }
 
+void PendingExchange::Release() noexcept {
+    if (request_ != nullptr) {
+        std::vector<uint8_t>().swap(request_->value);
+        request_.reset();
+    }
+}
+
 void PendingExchange::Signal() noexcept {
     assert(notification_ != nullptr);
     chs(notification_, int, 0);
+    if (cq_ != nullptr)
+        cq_->Push(tag_);
+}
+
+void PendingExchange::Fail(
+        ::com::seagate::kinetic::proto::Command_Status_StatusCode code,
+        const char *why) noexcept {
+    oio::kinetic::rpc::Request rep;
+    rep.cmd.mutable_header()->set_acksequence(seqid_);
+    rep.cmd.mutable_status()->set_code(code);
+    rep.cmd.mutable_status()->set_statusmessage(why);
+    ManageReply(rep);
+    Signal();
 }
 
 void PendingExchange::Wait() noexcept {
@@ -18,6 +18,16 @@ namespace oio {
 namespace kinetic {
 namespace client {
 
+// The queues of the scheduler of a connection
+enum class RequestClass : unsigned int {
+    SmallRead = 0, // metadata, listings, probes
+    LargeRead, // values
+    Write,
+    Background, // anything with a low priority
+};
+
+static constexpr unsigned int nb_request_classes = 4;
+
 class PendingExchange : public Sync {
   public:
     PendingExchange(oio::kinetic::rpc::Exchange *e) noexcept;
@@ -28,18 +38,92 @@ class PendingExchange : public Sync {
 
     int64_t Sequence() const noexcept;
 
+    void SetDeadline(int64_t dl) noexcept { deadline_ = dl; }
+
+    int64_t Deadline() const noexcept { return deadline_; }
+
+    // Tells if the exchange counts as a write in the admission control
+    void SetWrite(bool w) noexcept { write_ = w; }
+
+    bool IsWrite() const noexcept { return write_; }
+
+    ::com::seagate::kinetic::proto::Command_Priority Priority() const noexcept {
+        return exchange_->Priority();
+    }
+
+    // The deadline asked by the caller, 0 if none
+    int64_t RequestedDeadline() const noexcept {
+        return exchange_->Deadline();
+    }
+
+    // `cost` is the expected size of the request and its reply, in bytes
+    void SetClass(RequestClass c, uint64_t cost) noexcept {
+        class_ = c;
+        cost_ = cost;
+    }
+
+    RequestClass Class() const noexcept { return class_; }
+
+    uint64_t Cost() const noexcept { return cost_; }
+
+    // Tells if the exchange may be sent again on a new connection
+    void SetIdempotent(bool i) noexcept { idempotent_ = i; }
+
+    bool IsIdempotent() const noexcept { return idempotent_; }
+
+    // Number of times the exchange has been sent
+    unsigned int Attempts() const noexcept { return attempts_; }
+
+    // Keeps the request sent, so that its value survives until the reply
+    void Sent(std::shared_ptr<oio::kinetic::rpc::Request> req,
+              int64_t now_usec) noexcept {
+        request_ = req;
+        sent_usec_ = now_usec;
+        ++attempts_;
+    }
+
+    // When the exchange was last sent, in microseconds
+    int64_t SentAt() const noexcept { return sent_usec_; }
+
+    // Once its frame has really left, after the frames sent with it
+    void SetSentAt(int64_t now_usec) noexcept { sent_usec_ = now_usec; }
+
+    // Frees the value sent, once the exchange cannot be replayed anymore
+    void Release() noexcept;
+
+    // The completion will also be notified to `cq`, with `tag`
+    void SetCompletion(std::shared_ptr<CompletionQueue> cq,
+                       uint64_t tag) noexcept {
+        cq_ = cq;
+        tag_ = tag;
+    }
+
     void ManageReply (oio::kinetic::rpc::Request &rep) noexcept;
 
     std::shared_ptr<oio::kinetic::rpc::Request> MakeRequest() noexcept;
 
     void Signal() noexcept;
 
+    // Completes the exchange without any reply from the device
+    void Fail(::com::seagate::kinetic::proto::Command_Status_StatusCode code,
+              const char *why) noexcept;
+
     void Wait() noexcept;
 
   private:
     oio::kinetic::rpc::Exchange *exchange_;
     struct mill_chan *notification_;
     int64_t seqid_;
+    int64_t deadline_;
+    bool write_;
+    RequestClass class_;
+    uint64_t cost_;
+    std::shared_ptr<CompletionQueue> cq_;
+    uint64_t tag_;
+    bool idempotent_;
+    unsigned int attempts_;
+    int64_t sent_usec_;
+    std::shared_ptr<oio::kinetic::rpc::Request> request_;
 };
 
 } // namespace client
@@ -0,0 +1,121 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <utility>
+#include "PendingTable.h"
+
+using oio::kinetic::client::PendingTable;
+using oio::kinetic::client::PendingExchange;
+
+static constexpr size_t min_slots = 64;
+
+PendingTable::PendingTable() noexcept:
+        slots_(min_slots), deadlines_(), count_{0}, last_{0}, taken_{0} { }
+
+PendingTable::~PendingTable() noexcept { }
+
+void PendingTable::Insert(std::shared_ptr<PendingExchange> pe) noexcept {
+    assert(pe != nullptr);
+    while (slot(pe->Sequence()) != nullptr)
+        grow();
+    schedule(*pe);
+    last_ = std::max(last_, pe->Sequence());
+    slot(pe->Sequence()) = std::move(pe);
+    count_++;
+}
+
+std::shared_ptr<PendingExchange> PendingTable::Take(int64_t seqid) noexcept {
+    auto &s = slot(seqid);
+    if (s == nullptr || s->Sequence() != seqid)
+        return nullptr;
+    auto pe = std::move(s);
+    count_--;
+    // Amortized over as many replies as the ring has slots
+    if (++taken_ >= slots_.size() / 2) {
+        taken_ = 0;
+        while (count_ < slots_.size() / 8 && shrink()) { }
+    }
+    return pe;
+}
+
+bool PendingTable::Holds(const PendingExchange &pe) const noexcept {
+    const auto seqid = static_cast<uint64_t>(pe.Sequence());
+    return slots_[seqid & (slots_.size() - 1)].get() == &pe;
+}
+
+void PendingTable::SetDeadline(PendingExchange &pe, int64_t dl) noexcept {
+    pe.SetDeadline(dl);
+    if (Holds(pe))
+        schedule(pe);
+}
+
+void PendingTable::Expire(int64_t now,
+        std::vector<std::shared_ptr<PendingExchange>> &out) noexcept {
+    const std::greater<Deadline> later;
+    while (!deadlines_.empty() && deadlines_.front().first <= now) {
+        const auto seqid = deadlines_.front().second;
+        std::pop_heap(deadlines_.begin(), deadlines_.end(), later);
+        deadlines_.pop_back();
+
+        // Already replied, or rescheduled
+        auto &s = slot(seqid);
+        if (s == nullptr || s->Sequence() != seqid)
+            continue;
+        if (s->Deadline() > now) {
+            schedule(*s);
+            continue;
+        }
+        out.emplace_back(std::move(s));
+        count_--;
+    }
+}
+
+void PendingTable::schedule(const PendingExchange &pe) noexcept {
+    const std::greater<Deadline> later;
+    // Drop the entries of the exchanges gone, once they are the majority
+    if (deadlines_.size() > 2 * count_ + min_slots) {
+        deadlines_.clear();
+        for (const auto &s: slots_) {
+            if (s != nullptr)
+                deadlines_.emplace_back(s->Deadline(), s->Sequence());
+        }
+        std::make_heap(deadlines_.begin(), deadlines_.end(), later);
+    }
+    deadlines_.emplace_back(pe.Deadline(), pe.Sequence());
+    std::push_heap(deadlines_.begin(), deadlines_.end(), later);
+}
+
+void PendingTable::grow() noexcept {
+    std::vector<std::shared_ptr<PendingExchange>> old(slots_.size() * 2);
+    old.swap(slots_);
+    for (auto &pe: old) {
+        if (pe != nullptr)
+            slot(pe->Sequence()) = std::move(pe);
+    }
+}
+
+// Fails while an old exchange is held: the next sequences would collide
+// with it in the smaller ring, that would grow again at once.
+bool PendingTable::shrink() noexcept {
+    if (slots_.size() <= min_slots)
+        return false;
+    const auto half = slots_.size() / 2;
+    const auto oldest = last_ - static_cast<int64_t>(half / 2);
+    for (const auto &s: slots_) {
+        if (s != nullptr && s->Sequence() <= oldest)
+            return false;
+    }
+    for (size_t i = 0; i < half; ++i) {
+        if (slots_[i] == nullptr)
+            slots_[i] = std::move(slots_[i + half]);
+    }
+    slots_.resize(half);
+    slots_.shrink_to_fit();
+    return true;
+}
@@ -0,0 +1,75 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_PENDINGTABLE_H
+#define OIO_KINETIC_CLIENT_PENDINGTABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "PendingExchange.h"
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* In-flight exchanges, indexed by their sequence number. The sequence numbers
+ * of a connection are contiguous, so a ring addressed by the low bits of the
+ * sequence gives an O(1) match for each reply. The ring doubles when a slot
+ * is still held by an older exchange, and halves back once mostly empty.
+ * The deadlines are kept in a heap, so that the expiration doesn't visit
+ * the whole ring. */
+class PendingTable {
+  public:
+    PendingTable() noexcept;
+
+    ~PendingTable() noexcept;
+
+    void Insert(std::shared_ptr<PendingExchange> pe) noexcept;
+
+    // Returns nullptr if no exchange waits for that sequence
+    std::shared_ptr<PendingExchange> Take(int64_t seqid) noexcept;
+
+    // Changes the deadline of an exchange already inserted
+    void SetDeadline(PendingExchange &pe, int64_t dl) noexcept;
+
+    // Moves to `out` the exchanges whose deadline is before `now`
+    void Expire(int64_t now,
+                std::vector<std::shared_ptr<PendingExchange>> &out) noexcept;
+
+    // Tells if `pe` still waits for its reply
+    bool Holds(const PendingExchange &pe) const noexcept;
+
+    size_t Size() const noexcept { return count_; }
+
+    size_t Capacity() const noexcept { return slots_.size(); }
+
+  private:
+    typedef std::pair<int64_t, int64_t> Deadline; // deadline, sequence
+
+    std::shared_ptr<PendingExchange> &slot(int64_t seqid) noexcept {
+        return slots_[static_cast<uint64_t>(seqid) & (slots_.size() - 1)];
+    }
+
+    void grow() noexcept;
+
+    bool shrink() noexcept;
+
+    void schedule(const PendingExchange &pe) noexcept;
+
+    std::vector<std::shared_ptr<PendingExchange>> slots_;
+    std::vector<Deadline> deadlines_; // min-heap, with outdated entries
+    size_t count_;
+    int64_t last_; // the highest sequence inserted
+    size_t taken_; // since the last attempt to shrink
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_PENDINGTABLE_H
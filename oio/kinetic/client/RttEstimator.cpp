@@ -0,0 +1,30 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <time.h>
+#include "RttEstimator.h"
+
+using oio::kinetic::client::RttEstimator;
+
+void RttEstimator::Sample(int64_t rtt) noexcept {
+    if (rtt < 0)
+        return;
+    if (samples_++ == 0) {
+        srtt_ = rtt;
+        rttvar_ = rtt / 2;
+    } else {
+        // alpha = 1/8, beta = 1/4
+        const int64_t delta = rtt > srtt_ ? rtt - srtt_ : srtt_ - rtt;
+        rttvar_ += (delta - rttvar_) / 4;
+        srtt_ += (rtt - srtt_) / 8;
+    }
+}
+
+int64_t oio::kinetic::client::monotonic_usec() noexcept {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
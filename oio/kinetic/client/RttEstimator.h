@@ -0,0 +1,48 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_RTTESTIMATOR_H
+#define OIO_KINETIC_CLIENT_RTTESTIMATOR_H
+
+#include <cstdint>
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* Smoothed round-trip time, as TCP does it (RFC 6298). All the values are
+ * in microseconds, 0 until the first sample. */
+class RttEstimator {
+  public:
+    RttEstimator() noexcept: srtt_{0}, rttvar_{0}, samples_{0} { }
+
+    ~RttEstimator() noexcept { }
+
+    void Sample(int64_t rtt) noexcept;
+
+    int64_t Srtt() const noexcept { return srtt_; }
+
+    int64_t RttVar() const noexcept { return rttvar_; }
+
+    // The delay after which a reply can be considered lost
+    int64_t Rto() const noexcept { return srtt_ + 4 * rttvar_; }
+
+    uint64_t Samples() const noexcept { return samples_; }
+
+  private:
+    int64_t srtt_;
+    int64_t rttvar_;
+    uint64_t samples_;
+};
+
+// Monotonic clock, in microseconds
+int64_t monotonic_usec() noexcept;
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_RTTESTIMATOR_H
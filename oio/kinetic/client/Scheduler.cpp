@@ -0,0 +1,120 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include "Scheduler.h"
+
+using oio::kinetic::client::Scheduler;
+using oio::kinetic::client::PendingExchange;
+using oio::kinetic::client::RequestClass;
+
+// Bytes given to a class of weight 1 at each round
+static constexpr int64_t base_quantum = 16 * 1024;
+
+// Fixed cost of any exchange, for the headers
+static constexpr uint64_t frame_overhead = 256;
+
+static unsigned int _idx(RequestClass c) noexcept {
+    return static_cast<unsigned int>(c);
+}
+
+Scheduler::Scheduler() noexcept:
+        queues_(), cfg_(), current_{0}, visiting_{false}, size_{0} {
+    for (auto &q: queues_) {
+        q.deficit = 0;
+        q.inflight = 0;
+        q.avg_reply = 0;
+    }
+    queues_[_idx(RequestClass::LargeRead)].avg_reply = 256 * 1024;
+}
+
+void Scheduler::PushBack(std::shared_ptr<PendingExchange> pe) noexcept {
+    queues_[_idx(pe->Class())].items.emplace_back(std::move(pe));
+    ++size_;
+}
+
+void Scheduler::PushFront(std::shared_ptr<PendingExchange> pe) noexcept {
+    queues_[_idx(pe->Class())].items.emplace_front(std::move(pe));
+    ++size_;
+}
+
+std::shared_ptr<PendingExchange> Scheduler::Pop(
+        const std::function<bool(const PendingExchange &)> &admit) noexcept {
+    if (size_ == 0)
+        return nullptr;
+
+    // Each round gives a quantum to the classes that may send. The round
+    // is repeated until one class has accumulated enough for its head.
+    for (;;) {
+        bool eligible = false;
+        for (unsigned int i = 0; i < nb_request_classes; ++i) {
+            auto &q = queues_[current_];
+            const auto cap = cfg_.caps[current_];
+            bool blocked = q.items.empty()
+                           || !admit(*q.items.front())
+                           || (cap > 0 && q.inflight > 0
+                               && q.inflight + q.items.front()->Cost() > cap);
+            if (q.items.empty())
+                q.deficit = 0;
+            if (!blocked) {
+                eligible = true;
+                if (!visiting_) {
+                    q.deficit += base_quantum * cfg_.weights[current_];
+                    visiting_ = true;
+                }
+                const auto cost = q.items.front()->Cost();
+                if (static_cast<int64_t>(cost) <= q.deficit) {
+                    auto pe = std::move(q.items.front());
+                    q.items.pop_front();
+                    --size_;
+                    q.deficit -= cost;
+                    q.inflight += cost;
+                    return pe;
+                }
+            }
+            current_ = (current_ + 1) % nb_request_classes;
+            visiting_ = false;
+        }
+        if (!eligible)
+            return nullptr;
+    }
+}
+
+void Scheduler::Done(const PendingExchange &pe) noexcept {
+    auto &q = queues_[_idx(pe.Class())];
+    assert(q.inflight >= pe.Cost());
+    q.inflight -= pe.Cost();
+}
+
+void Scheduler::ResetInflight() noexcept {
+    for (auto &q: queues_)
+        q.inflight = 0;
+}
+
+void Scheduler::Expire(int64_t now,
+                       std::vector<std::shared_ptr<PendingExchange>> &out) noexcept {
+    for (auto &q: queues_) {
+        std::deque<std::shared_ptr<PendingExchange>> alive;
+        for (auto &pe: q.items) {
+            if (now >= 0 && pe->Deadline() > now)
+                alive.emplace_back(std::move(pe));
+            else
+                out.emplace_back(std::move(pe));
+        }
+        size_ -= q.items.size() - alive.size();
+        q.items.swap(alive);
+    }
+}
+
+void Scheduler::ObserveReply(RequestClass c, size_t bytes) noexcept {
+    auto &avg = queues_[_idx(c)].avg_reply;
+    avg = (7 * avg + bytes) / 8;
+}
+
+uint64_t Scheduler::EstimateCost(RequestClass c,
+                                 size_t request_bytes) const noexcept {
+    return frame_overhead + request_bytes + queues_[_idx(c)].avg_reply;
+}
@@ -0,0 +1,95 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_SCHEDULER_H
+#define OIO_KINETIC_CLIENT_SCHEDULER_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "PendingExchange.h"
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+struct SchedulerConfig {
+    // Share of each class, relative to the others
+    std::array<unsigned int, nb_request_classes> weights;
+    // Bytes in flight allowed per class, 0 for no limit
+    std::array<uint64_t, nb_request_classes> caps;
+
+    SchedulerConfig() noexcept:
+            weights{{8, 4, 2, 1}},
+            caps{{1024 * 1024, 16 * 1024 * 1024, 16 * 1024 * 1024,
+                         4 * 1024 * 1024}} { }
+};
+
+/* Queues the exchanges of a connection in several classes, and serves the
+ * classes with a deficit round robin weighted by their expected size in
+ * bytes, so that a flow of large requests doesn't starve the small ones. */
+class Scheduler {
+  public:
+    Scheduler() noexcept;
+
+    ~Scheduler() noexcept { }
+
+    void Configure(const SchedulerConfig &cfg) noexcept { cfg_ = cfg; }
+
+    void PushBack(std::shared_ptr<PendingExchange> pe) noexcept;
+
+    // The exchange will be the next of its class
+    void PushFront(std::shared_ptr<PendingExchange> pe) noexcept;
+
+    // Returns the next exchange to send, nullptr if none can go. An
+    // exchange is eligible if `admit` accepts it and its class is under
+    // its cap. The cost of the exchange is accounted as in flight.
+    std::shared_ptr<PendingExchange> Pop(
+            const std::function<bool(const PendingExchange &)> &admit) noexcept;
+
+    // Accounts the end of an exchange given by Pop()
+    void Done(const PendingExchange &pe) noexcept;
+
+    // Forgets the exchanges in flight, e.g. after a connection loss
+    void ResetInflight() noexcept;
+
+    // Moves out the queued exchanges whose deadline has passed, or all of
+    // them if `now` is negative
+    void Expire(int64_t now,
+                std::vector<std::shared_ptr<PendingExchange>> &out) noexcept;
+
+    bool Empty() const noexcept { return size_ == 0; }
+
+    size_t Size() const noexcept { return size_; }
+
+    // Expected size of the reply to the exchanges of a class
+    void ObserveReply(RequestClass c, size_t bytes) noexcept;
+
+    uint64_t EstimateCost(RequestClass c, size_t request_bytes) const noexcept;
+
+  private:
+    struct Queue {
+        std::deque<std::shared_ptr<PendingExchange>> items;
+        int64_t deficit;
+        uint64_t inflight;
+        uint64_t avg_reply; // exponential moving average
+    };
+
+    std::array<Queue, nb_request_classes> queues_;
+    SchedulerConfig cfg_;
+    unsigned int current_;
+    bool visiting_; // the quantum of the current class has been given
+    size_t size_;
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_SCHEDULER_H
@@ -0,0 +1,121 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include "StripedClient.h"
+
+using oio::kinetic::rpc::Exchange;
+using oio::kinetic::client::StripedClient;
+using oio::kinetic::client::CoroutineClient;
+using oio::kinetic::client::Sync;
+using oio::kinetic::client::SyncGroup;
+using oio::kinetic::client::CompletionQueue;
+using oio::kinetic::client::DeviceLimits;
+using oio::kinetic::client::Credentials;
+using oio::kinetic::client::SchedulerConfig;
+
+StripedClient::StripedClient(const std::string &u, unsigned int nb,
+                             const Credentials &c) noexcept:
+        url_{u}, health_(new DriveHealth(u)), stripes_(), next_{0} {
+    assert(nb > 0);
+    // The connections share their view of the drive
+    for (unsigned int i = 0; i < nb; ++i)
+        stripes_.emplace_back(new CoroutineClient(u, c, health_));
+}
+
+StripedClient::~StripedClient() noexcept { }
+
+std::string StripedClient::Id() const noexcept {
+    return url_;
+}
+
+bool StripedClient::IsDown() const noexcept {
+    return health_->IsDown();
+}
+
+int64_t StripedClient::Latency() const noexcept {
+    // The same drive answers on every stripe: the best estimate wins
+    int64_t best = 0;
+    for (const auto &s: stripes_) {
+        const auto l = s->Latency();
+        if (l > 0 && (best == 0 || l < best))
+            best = l;
+    }
+    return best;
+}
+
+void StripedClient::Scheduling(const SchedulerConfig &cfg) noexcept {
+    for (auto &s: stripes_)
+        s->Scheduling(cfg);
+}
+
+DeviceLimits StripedClient::Limits() const noexcept {
+    // Any stripe connected knows them
+    for (const auto &s: stripes_) {
+        if (s->LimitsKnown())
+            return s->Limits();
+    }
+    return stripes_[0]->Limits();
+}
+
+unsigned int StripedClient::pick(const std::vector<size_t> &extra) noexcept {
+    // Rotate the first candidate, so that idle stripes are used in turn
+    const auto nb = stripes_.size();
+    const auto first = next_++ % nb;
+    auto best = first;
+    for (unsigned int i = 1; i < nb; ++i) {
+        const auto idx = (first + i) % nb;
+        if (stripes_[idx]->Load() + extra[idx]
+            < stripes_[best]->Load() + extra[best])
+            best = idx;
+    }
+    return best;
+}
+
+std::shared_ptr<Sync> StripedClient::Start(Exchange *ex) noexcept {
+    return Start(ex, nullptr, 0);
+}
+
+std::shared_ptr<Sync> StripedClient::Start(
+        Exchange *ex, std::shared_ptr<CompletionQueue> cq,
+        uint64_t tag) noexcept {
+    const std::vector<size_t> none(stripes_.size(), 0);
+    const auto best = pick(none);
+    return static_cast<ClientInterface*>(
+            stripes_[best].get())->Start(ex, cq, tag);
+}
+
+std::shared_ptr<SyncGroup> StripedClient::StartMany(
+        const std::vector<Exchange *> &exs) noexcept {
+    // Spread the exchanges, then submit each stripe's share at once
+    const auto nb = stripes_.size();
+    std::vector<size_t> extra(nb, 0);
+    std::vector<unsigned int> where(exs.size());
+    for (unsigned int i = 0; i < exs.size(); ++i) {
+        where[i] = pick(extra);
+        ++extra[where[i]];
+    }
+
+    std::vector<std::shared_ptr<SyncGroup>> parts(nb);
+    std::vector<size_t> next(nb, 0);
+    for (unsigned int s = 0; s < nb; ++s) {
+        if (extra[s] == 0)
+            continue;
+        std::vector<Exchange *> share;
+        for (unsigned int i = 0; i < exs.size(); ++i) {
+            if (where[i] == s)
+                share.push_back(exs[i]);
+        }
+        parts[s] = static_cast<ClientInterface*>(
+                stripes_[s].get())->StartMany(share);
+    }
+
+    // Keep the order of the submission in the group
+    std::shared_ptr<SyncGroup> group(new SyncGroup);
+    for (unsigned int i = 0; i < exs.size(); ++i)
+        group->Add(parts[where[i]]->At(next[where[i]]++));
+    return group;
+}
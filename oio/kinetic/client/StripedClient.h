@@ -0,0 +1,72 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_CLIENT_STRIPEDCLIENT_H
+#define OIO_KINETIC_CLIENT_STRIPEDCLIENT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <oio/kinetic/rpc/Exchange.h>
+#include "ClientInterface.h"
+#include "CoroutineClient.h"
+
+namespace oio {
+namespace kinetic {
+namespace client {
+
+/* Spreads the RPC to a single drive over several connections. Each exchange
+ * goes to the connection with the fewest queued and in-flight exchanges, so
+ * that a large transfer doesn't delay the small ones behind it. */
+class StripedClient : public ClientInterface {
+  public:
+    StripedClient(const std::string &u, unsigned int nb,
+                  const Credentials &c = Credentials()) noexcept;
+
+    bool IsDown() const noexcept;
+
+    int64_t Latency() const noexcept;
+
+    // Applies the same scheduling to every stripe
+    void Scheduling(const SchedulerConfig &cfg) noexcept;
+
+    ~StripedClient() noexcept;
+
+    std::shared_ptr<Sync> Start(oio::kinetic::rpc::Exchange *ex) noexcept;
+
+    std::shared_ptr<Sync> Start(oio::kinetic::rpc::Exchange *ex,
+                                std::shared_ptr<CompletionQueue> cq,
+                                uint64_t tag) noexcept;
+
+    std::shared_ptr<SyncGroup> StartMany(
+            const std::vector<oio::kinetic::rpc::Exchange *> &exs) noexcept;
+
+    std::string Id() const noexcept;
+
+    DeviceLimits Limits() const noexcept;
+
+  private:
+    StripedClient() = delete;
+
+    // Index of the stripe with the fewest exchanges, `extra` counting
+    // the exchanges about to be submitted to each stripe
+    unsigned int pick(const std::vector<size_t> &extra) noexcept;
+
+    StripedClient(const StripedClient &o) = delete;
+
+    StripedClient(StripedClient &&o) = delete;
+
+    std::string url_;
+    std::shared_ptr<DriveHealth> health_;
+    std::vector<std::unique_ptr<CoroutineClient>> stripes_;
+    unsigned int next_;
+};
+
+} // namespace client
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_CLIENT_STRIPEDCLIENT_H
@@ -162,5 +162,13 @@ int main(int argc UNUSED, char **argv) {
         test_single_getnext(factory.Get(device));
     } while (0);
 
+    do { // one batch with several connections to the device
+        CoroutineClientFactory striped(4);
+        auto client = striped.Get(device);
+        test_multi_upload(client);
+        test_array_upload(client);
+        test_single_get(client);
+    } while (0);
+
     return 0;
 }
\ No newline at end of file
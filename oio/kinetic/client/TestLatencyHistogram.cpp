@@ -0,0 +1,103 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include <utils/utils.h>
+#include "LatencyHistogram.h"
+
+using oio::kinetic::client::LatencyHistogram;
+
+static int64_t bound_of(int64_t v) noexcept {
+    LatencyHistogram h;
+    h.Record(v);
+    return h.Percentile(1.0);
+}
+
+// Any value is reported by the upper bound of its bucket: never below it,
+// never more than a quarter above it, 4 buckets per power of two.
+static void test_bucket_bounds() noexcept {
+    int64_t prev = -1;
+    for (int64_t v = 0; v < 100000; ++v) {
+        const auto b = bound_of(v);
+        assert(b >= v);
+        assert(b <= v + v / 4);
+        assert(b >= prev);
+        // A new bucket starts right after the bound of the previous one
+        if (b != prev)
+            assert(v == 0 || v == prev + 1);
+        prev = b;
+    }
+    for (int64_t v = 100000; v < (1LL << 40); v = v * 3 / 2 + 7) {
+        const auto b = bound_of(v);
+        assert(b >= v && b <= v + v / 4);
+    }
+}
+
+static void test_empty() noexcept {
+    LatencyHistogram h;
+    assert(h.Count() == 0);
+    assert(h.Percentile(0.5) == 0);
+    assert(h.Percentile(1.0) == 0);
+    h.Record(-5);
+    assert(h.Count() == 0);
+}
+
+static void test_percentiles() noexcept {
+    LatencyHistogram h;
+    for (int64_t v = 1; v <= 1000; ++v)
+        h.Record(v);
+    assert(h.Count() == 1000);
+
+    const auto p50 = h.Percentile(0.5);
+    const auto p99 = h.Percentile(0.99);
+    assert(p50 >= 500 && p50 <= 625);
+    assert(p99 >= 990 && p99 <= 1250);
+    assert(h.Percentile(1.0) >= 1000);
+
+    int64_t prev = 0;
+    for (double q = 0.01; q <= 1.0; q += 0.01) {
+        const auto p = h.Percentile(q);
+        assert(p >= prev);
+        prev = p;
+    }
+}
+
+// The old samples fade away, the percentiles follow the recent latencies
+static void test_decay() noexcept {
+    LatencyHistogram h;
+    for (int i = 0; i < 8192; ++i)
+        h.Record(100);
+    assert(h.Percentile(0.99) <= 125);
+    for (int i = 0; i < 3 * 4096; ++i)
+        h.Record(10000);
+    assert(h.Percentile(0.5) >= 10000);
+    assert(h.Count() < 2 * 4096);
+}
+
+// Beyond the last bucket, the values are kept in it
+static void test_overflow() noexcept {
+    LatencyHistogram h;
+    h.Record(INT64_MAX);
+    assert(h.Count() == 1);
+    const auto top = h.Percentile(1.0);
+    assert(top >= bound_of(1LL << 41));
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_bucket_bounds();
+    test_empty();
+    test_percentiles();
+    test_decay();
+    test_overflow();
+    return 0;
+}
@@ -0,0 +1,164 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <glog/logging.h>
+
+#include <utils/utils.h>
+#include <oio/kinetic/rpc/Put.h>
+#include <oio/kinetic/rpc/Get.h>
+#include <oio/kinetic/rpc/Delete.h>
+#include <oio/kinetic/rpc/GetKeyRange.h>
+#include "Packer.h"
+
+using oio::kinetic::client::Credentials;
+using oio::kinetic::client::Frame;
+using oio::kinetic::client::Packer;
+using oio::kinetic::rpc::Exchange;
+using oio::kinetic::rpc::Request;
+using oio::kinetic::rpc::Put;
+using oio::kinetic::rpc::Get;
+using oio::kinetic::rpc::Delete;
+using oio::kinetic::rpc::GetKeyRange;
+namespace proto = ::com::seagate::kinetic::proto;
+
+// The signature of the Kinetic devices, computed from scratch
+static std::string reference_hmac(const std::string &key,
+                                  const std::string &cmd) noexcept {
+    std::string signed_bytes;
+    if (!cmd.empty()) {
+        uint32_t be = ::htonl(cmd.size());
+        signed_bytes.assign(reinterpret_cast<char *>(&be), sizeof(be));
+        signed_bytes.append(cmd);
+    }
+    uint8_t out[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    ::HMAC(EVP_sha1(), key.data(), key.size(),
+           reinterpret_cast<const uint8_t *>(signed_bytes.data()),
+           signed_bytes.size(), out, &len);
+    return std::string(reinterpret_cast<char *>(out), len);
+}
+
+// The frame packed by the Packer must be the Message the protobuf library
+// would have serialized, signed the same way.
+static void check_pack(const Credentials &creds, Exchange &ex, int64_t seq,
+                       int64_t cnxid, proto::Command_Priority prio,
+                       int64_t timeout) noexcept {
+    Packer packer(creds);
+    ex.SetSequence(seq);
+    auto req = ex.MakeRequest();
+    const std::vector<uint8_t> value(req->value);
+
+    Frame frame;
+    packer.Pack(*req, cnxid, prio, timeout, frame);
+
+    const auto &h = req->cmd.header();
+    assert(h.sequence() == seq);
+    assert(h.connectionid() == cnxid);
+    assert(h.priority() == prio);
+    assert(h.timeout() == timeout);
+
+    proto::Message msg;
+    msg.set_authtype(proto::Message_AuthType_HMACAUTH);
+    msg.mutable_hmacauth()->set_identity(creds.identity);
+    msg.set_commandbytes(req->cmd.SerializeAsString());
+    msg.mutable_hmacauth()->set_hmac(
+            reference_hmac(creds.key, msg.commandbytes()));
+    const auto expected = msg.SerializeAsString();
+
+    assert(expected.size() == frame.msg.size());
+    assert(expected == std::string(frame.msg.begin(), frame.msg.end()));
+    assert(value == frame.val);
+    assert(req->value.empty());
+
+    // The devices decode it back
+    proto::Message decoded;
+    assert(decoded.ParseFromArray(frame.msg.data(), frame.msg.size()));
+    assert(decoded.hmacauth().identity() == creds.identity);
+}
+
+static void test_commands(const Credentials &creds) noexcept {
+    const int64_t seqs[] = {0, 1, 127, 128, 300, 1LL << 35, INT64_MAX};
+    for (auto seq: seqs) {
+        Put put;
+        put.Key("k");
+        put.Value(std::string(4096, 'v'));
+        check_pack(creds, put, seq, 1, proto::Command_Priority_NORMAL, 1000);
+
+        Put empty;
+        empty.Key(std::string(300, 'k'));
+        empty.Value(std::string());
+        check_pack(creds, empty, seq, 1LL << 40,
+                   proto::Command_Priority_LOWER, 1);
+
+        Get get;
+        get.Key("k");
+        check_pack(creds, get, seq, 7, proto::Command_Priority_HIGHER, 60000);
+
+        Delete del;
+        del.Key("chunk-=00000001-00080000");
+        check_pack(creds, del, seq, 0, proto::Command_Priority_LOWEST, 0);
+
+        GetKeyRange range;
+        range.Start("a");
+        range.End("z");
+        range.IncludeStart(true);
+        range.MaxItems(200);
+        check_pack(creds, range, seq, -1, proto::Command_Priority_HIGHEST,
+                   5000);
+    }
+}
+
+// Each field of the authentication, with the sizes changing their encoding
+static void test_credentials() noexcept {
+    const int64_t identities[] = {1, 0, 127, 128, 16384, 1LL << 40, -1};
+    for (auto id: identities)
+        test_commands(Credentials(id, "asdfasdf"));
+
+    test_commands(Credentials());
+    test_commands(Credentials(1, ""));
+    test_commands(Credentials(1, std::string(64, 'k')));
+    test_commands(Credentials(1, std::string(200, 'k')));
+}
+
+// The same packer for several frames, as on a connection
+static void test_reuse() noexcept {
+    const Credentials creds(2, "secret");
+    Packer packer(creds);
+    for (int i = 0; i < 8; ++i) {
+        Put put;
+        put.Key("k" + std::to_string(i));
+        put.Value(std::string(i * 1000, 'x'));
+        put.SetSequence(i);
+        auto req = put.MakeRequest();
+        Frame frame;
+        packer.Pack(*req, 3, proto::Command_Priority_NORMAL, 1000, frame);
+        assert(frame.val.size() == static_cast<size_t>(i * 1000));
+
+        proto::Message msg;
+        assert(msg.ParseFromArray(frame.msg.data(), frame.msg.size()));
+        assert(msg.commandbytes() == req->cmd.SerializeAsString());
+        assert(msg.hmacauth().hmac() ==
+               reference_hmac(creds.key, msg.commandbytes()));
+    }
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_credentials();
+    test_reuse();
+    return 0;
+}
@@ -0,0 +1,144 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <utils/utils.h>
+#include <oio/kinetic/rpc/Noop.h>
+#include "PendingTable.h"
+
+using oio::kinetic::client::PendingTable;
+using oio::kinetic::client::PendingExchange;
+using oio::kinetic::rpc::Noop;
+
+static Noop noop;
+
+static std::shared_ptr<PendingExchange> make(int64_t seqid,
+                                             int64_t deadline) noexcept {
+    std::shared_ptr<PendingExchange> pe(new PendingExchange(&noop));
+    pe->SetSequence(seqid);
+    pe->SetDeadline(deadline);
+    return pe;
+}
+
+static void test_match() noexcept {
+    PendingTable table;
+    auto pe = make(5, 100);
+    table.Insert(pe);
+    assert(table.Size() == 1 && table.Holds(*pe));
+
+    // Same slot, another sequence
+    assert(table.Take(5 + table.Capacity()) == nullptr);
+    assert(table.Take(5) == pe);
+    assert(table.Size() == 0 && !table.Holds(*pe));
+    assert(table.Take(5) == nullptr);
+}
+
+// A straggler makes the ring grow, which shrinks back once it is gone
+static void test_grow_shrink() noexcept {
+    PendingTable table;
+    const auto initial = table.Capacity();
+    auto straggler = make(0, 100);
+    table.Insert(straggler);
+
+    int64_t seqid = 1;
+    for (; seqid < 4096; ++seqid)
+        table.Insert(make(seqid, 100));
+    for (int64_t s = 1; s < 4096; ++s)
+        assert(table.Take(s) != nullptr);
+    assert(table.Size() == 1);
+    assert(table.Capacity() >= 4096);
+    const auto large = table.Capacity();
+
+    // Still held in a large ring, the straggler spans the sequences
+    for (int i = 0; i < 4096; ++i, ++seqid) {
+        table.Insert(make(seqid, 100));
+        assert(table.Take(seqid) != nullptr);
+    }
+    assert(table.Holds(*straggler));
+    assert(table.Capacity() >= large / 2);
+
+    assert(table.Take(0) == straggler);
+    for (int i = 0; i < 4096; ++i, ++seqid) {
+        table.Insert(make(seqid, 100));
+        assert(table.Take(seqid) != nullptr);
+    }
+    assert(table.Capacity() == initial);
+
+    // Nothing lost on the way
+    std::vector<std::shared_ptr<PendingExchange>> kept;
+    for (int i = 0; i < 48; ++i, ++seqid) {
+        kept.push_back(make(seqid, 100));
+        table.Insert(kept.back());
+    }
+    for (const auto &pe: kept)
+        assert(table.Take(pe->Sequence()) == pe);
+}
+
+static void test_expire() noexcept {
+    PendingTable table;
+    std::vector<std::shared_ptr<PendingExchange>> out;
+    for (int64_t s = 0; s < 1000; ++s)
+        table.Insert(make(s, 1000 - s));
+
+    // Only the overdue ones, not those already replied
+    assert(table.Take(999) != nullptr);
+    table.Expire(10, out);
+    assert(out.size() == 9);
+    for (const auto &pe: out)
+        assert(pe->Deadline() <= 10 && !table.Holds(*pe));
+    assert(table.Size() == 990);
+
+    // A deadline moved away, then closer
+    auto later = make(2000, 50);
+    auto sooner = make(2001, 500);
+    table.Insert(later);
+    table.Insert(sooner);
+    table.SetDeadline(*later, 5000);
+    table.SetDeadline(*sooner, 20);
+    out.clear();
+    table.Expire(100, out);
+    assert(out.size() == 91);
+    assert(table.Holds(*later) && !table.Holds(*sooner));
+
+    out.clear();
+    table.Expire(INT64_MAX, out);
+    assert(out.size() == 901);
+    assert(table.Size() == 0);
+    out.clear();
+    table.Expire(INT64_MAX, out);
+    assert(out.empty());
+}
+
+// The deadlines of the exchanges replied don't pile up
+static void test_no_leak() noexcept {
+    PendingTable table;
+    std::vector<std::shared_ptr<PendingExchange>> out;
+    for (int64_t s = 0; s < 1000000; ++s) {
+        table.Insert(make(s, INT64_MAX - 1));
+        assert(table.Take(s) != nullptr);
+    }
+    auto last = make(1000000, 10);
+    table.Insert(last);
+    table.Expire(10, out);
+    assert(out.size() == 1 && out[0] == last);
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_match();
+    test_grow_shrink();
+    test_expire();
+    test_no_leak();
+    return 0;
+}
@@ -0,0 +1,94 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include <utils/utils.h>
+#include "RttEstimator.h"
+
+using oio::kinetic::client::RttEstimator;
+using oio::kinetic::client::monotonic_usec;
+
+static void test_first_sample() noexcept {
+    RttEstimator rtt;
+    assert(rtt.Samples() == 0);
+    assert(rtt.Srtt() == 0 && rtt.Rto() == 0);
+
+    // As RFC 6298: SRTT = R, RTTVAR = R/2
+    rtt.Sample(1000);
+    assert(rtt.Samples() == 1);
+    assert(rtt.Srtt() == 1000);
+    assert(rtt.RttVar() == 500);
+    assert(rtt.Rto() == 3000);
+
+    // Not a time, ignored
+    rtt.Sample(-1);
+    assert(rtt.Samples() == 1);
+    assert(rtt.Srtt() == 1000);
+}
+
+static void test_steady() noexcept {
+    RttEstimator rtt;
+    for (int i = 0; i < 200; ++i)
+        rtt.Sample(2000);
+    assert(rtt.Srtt() == 2000);
+    // The variation vanishes, down to the rounding
+    assert(rtt.RttVar() < 4);
+    assert(rtt.Rto() >= rtt.Srtt() && rtt.Rto() < 2016);
+}
+
+static void test_step() noexcept {
+    RttEstimator rtt;
+    for (int i = 0; i < 100; ++i)
+        rtt.Sample(1000);
+
+    // SRTT moves by 1/8 of the gap, RTTVAR by 1/4 of it
+    const auto var = rtt.RttVar();
+    rtt.Sample(9000);
+    assert(rtt.Srtt() == 2000);
+    assert(rtt.RttVar() == var + (8000 - var) / 4);
+    assert(rtt.Rto() > 9000);
+
+    // Then converges to the new delay
+    for (int i = 0; i < 200; ++i)
+        rtt.Sample(9000);
+    assert(rtt.Srtt() > 8990 && rtt.Srtt() <= 9000);
+    assert(rtt.Rto() >= rtt.Srtt() && rtt.Rto() < 9100);
+}
+
+// A spike raises the timeout at once, for longer than the smoothed delay
+static void test_spike() noexcept {
+    RttEstimator rtt;
+    for (int i = 0; i < 100; ++i)
+        rtt.Sample(1000);
+    const auto before = rtt.Rto();
+    rtt.Sample(50000);
+    assert(rtt.Rto() > before + 40000);
+    for (int i = 0; i < 4; ++i)
+        rtt.Sample(1000);
+    assert(rtt.Rto() > 2 * rtt.Srtt());
+}
+
+static void test_clock() noexcept {
+    const auto t0 = monotonic_usec();
+    const auto t1 = monotonic_usec();
+    assert(t0 > 0 && t1 >= t0);
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_first_sample();
+    test_steady();
+    test_step();
+    test_spike();
+    test_clock();
+    return 0;
+}
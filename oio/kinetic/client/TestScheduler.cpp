@@ -0,0 +1,227 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <utils/utils.h>
+#include <oio/kinetic/rpc/Noop.h>
+#include "Scheduler.h"
+
+using oio::kinetic::client::Scheduler;
+using oio::kinetic::client::SchedulerConfig;
+using oio::kinetic::client::PendingExchange;
+using oio::kinetic::client::RequestClass;
+using oio::kinetic::client::nb_request_classes;
+using oio::kinetic::rpc::Noop;
+
+static Noop noop;
+
+static std::shared_ptr<PendingExchange> make(RequestClass c, uint64_t cost,
+                                             int64_t deadline = 0) noexcept {
+    std::shared_ptr<PendingExchange> pe(new PendingExchange(&noop));
+    pe->SetClass(c, cost);
+    pe->SetDeadline(deadline);
+    return pe;
+}
+
+static bool admit_all(const PendingExchange &) noexcept { return true; }
+
+static unsigned int _idx(RequestClass c) noexcept {
+    return static_cast<unsigned int>(c);
+}
+
+static SchedulerConfig uncapped() noexcept {
+    SchedulerConfig cfg;
+    cfg.caps.fill(0);
+    return cfg;
+}
+
+// With every class backlogged, each one gets bytes in the ratio of its
+// weight, none is starved by the large exchanges of the others.
+static void test_weights() noexcept {
+    Scheduler sched;
+    sched.Configure(uncapped());
+    const std::array<RequestClass, nb_request_classes> classes{{
+            RequestClass::SmallRead, RequestClass::LargeRead,
+            RequestClass::Write, RequestClass::Background}};
+    const std::array<uint64_t, nb_request_classes> costs{{
+            1024, 64 * 1024, 256 * 1024, 256 * 1024}};
+    // Enough for each class to stay backlogged
+    const std::array<unsigned int, nb_request_classes> counts{{
+            40000, 400, 60, 40}};
+    for (unsigned int i = 0; i < nb_request_classes; ++i) {
+        for (unsigned int j = 0; j < counts[i]; ++j)
+            sched.PushBack(make(classes[i], costs[i]));
+    }
+
+    std::array<uint64_t, nb_request_classes> served;
+    served.fill(0);
+    uint64_t total = 0;
+    while (total < 64 * 1024 * 1024) {
+        auto pe = sched.Pop(admit_all);
+        assert(pe != nullptr);
+        served[_idx(pe->Class())] += pe->Cost();
+        total += pe->Cost();
+        sched.Done(*pe);
+    }
+
+    const SchedulerConfig cfg;
+    for (unsigned int i = 0; i < nb_request_classes; ++i) {
+        const double expected = static_cast<double>(total) * cfg.weights[i]
+                                / (8 + 4 + 2 + 1);
+        assert(served[i] > 0.8 * expected && served[i] < 1.2 * expected);
+    }
+}
+
+// A small exchange queued behind a flow of large ones goes within a round
+static void test_no_starvation() noexcept {
+    Scheduler sched;
+    sched.Configure(uncapped());
+    for (int i = 0; i < 64; ++i)
+        sched.PushBack(make(RequestClass::Write, 4 * 1024 * 1024));
+    for (int i = 0; i < 4; ++i) {
+        auto pe = sched.Pop(admit_all);
+        assert(pe != nullptr && pe->Class() == RequestClass::Write);
+        sched.Done(*pe);
+    }
+
+    sched.PushBack(make(RequestClass::Background, 4096));
+    sched.PushBack(make(RequestClass::SmallRead, 512));
+    bool small = false, background = false;
+    for (int i = 0; i < 4 && !(small && background); ++i) {
+        auto pe = sched.Pop(admit_all);
+        assert(pe != nullptr);
+        small = small || pe->Class() == RequestClass::SmallRead;
+        background = background || pe->Class() == RequestClass::Background;
+        sched.Done(*pe);
+    }
+    assert(small && background);
+}
+
+static void test_caps() noexcept {
+    Scheduler sched;
+    SchedulerConfig cfg = uncapped();
+    cfg.caps[_idx(RequestClass::Write)] = 4 * 1024 * 1024;
+    sched.Configure(cfg);
+    for (int i = 0; i < 16; ++i)
+        sched.PushBack(make(RequestClass::Write, 1024 * 1024));
+
+    // Up to the cap, then nothing until an exchange is done
+    std::vector<std::shared_ptr<PendingExchange>> sent;
+    while (auto pe = sched.Pop(admit_all))
+        sent.push_back(pe);
+    assert(sent.size() == 4);
+    assert(sched.Size() == 12);
+
+    // Another class isn't held by the cap
+    sched.PushBack(make(RequestClass::SmallRead, 100));
+    auto small = sched.Pop(admit_all);
+    assert(small != nullptr && small->Class() == RequestClass::SmallRead);
+    sched.Done(*small);
+    assert(sched.Pop(admit_all) == nullptr);
+
+    sched.Done(*sent.back());
+    sent.pop_back();
+    auto pe = sched.Pop(admit_all);
+    assert(pe != nullptr && pe->Class() == RequestClass::Write);
+    sent.push_back(pe);
+    assert(sched.Pop(admit_all) == nullptr);
+
+    // After a connection loss, nothing is in flight anymore
+    sched.ResetInflight();
+    sent.clear();
+    while (auto pe = sched.Pop(admit_all))
+        sent.push_back(pe);
+    assert(sent.size() == 4);
+
+    // An exchange larger than the cap goes alone
+    Scheduler alone;
+    alone.Configure(cfg);
+    alone.PushBack(make(RequestClass::Write, 16 * 1024 * 1024));
+    alone.PushBack(make(RequestClass::Write, 1));
+    auto large = alone.Pop(admit_all);
+    assert(large != nullptr && large->Cost() == 16 * 1024 * 1024);
+    assert(alone.Pop(admit_all) == nullptr);
+    alone.Done(*large);
+    assert(alone.Pop(admit_all) != nullptr);
+}
+
+static void test_admission() noexcept {
+    Scheduler sched;
+    sched.PushBack(make(RequestClass::Write, 100));
+    sched.PushBack(make(RequestClass::SmallRead, 100));
+    auto no_write = [](const PendingExchange &pe) {
+        return pe.Class() != RequestClass::Write;
+    };
+    auto pe = sched.Pop(no_write);
+    assert(pe != nullptr && pe->Class() == RequestClass::SmallRead);
+    sched.Done(*pe);
+    assert(sched.Pop(no_write) == nullptr);
+    assert(sched.Size() == 1);
+    pe = sched.Pop(admit_all);
+    assert(pe != nullptr && pe->Class() == RequestClass::Write);
+    assert(sched.Empty());
+}
+
+// A replayed exchange goes before the others of its class
+static void test_push_front() noexcept {
+    Scheduler sched;
+    auto first = make(RequestClass::Write, 100);
+    auto second = make(RequestClass::Write, 100);
+    sched.PushBack(first);
+    sched.PushBack(second);
+    auto pe = sched.Pop(admit_all);
+    assert(pe == first);
+    sched.Done(*pe);
+    sched.PushFront(pe);
+    assert(sched.Size() == 2);
+    assert(sched.Pop(admit_all) == first);
+    assert(sched.Pop(admit_all) == second);
+}
+
+static void test_expire() noexcept {
+    Scheduler sched;
+    sched.PushBack(make(RequestClass::SmallRead, 100, 10));
+    sched.PushBack(make(RequestClass::SmallRead, 100, 30));
+    sched.PushBack(make(RequestClass::Write, 100, 20));
+    sched.PushBack(make(RequestClass::Background, 100, 40));
+
+    std::vector<std::shared_ptr<PendingExchange>> out;
+    sched.Expire(20, out);
+    assert(out.size() == 2);
+    for (const auto &pe: out)
+        assert(pe->Deadline() <= 20);
+    assert(sched.Size() == 2);
+
+    // The others are still served
+    auto pe = sched.Pop(admit_all);
+    assert(pe != nullptr && pe->Deadline() == 30);
+
+    out.clear();
+    sched.Expire(-1, out);
+    assert(out.size() == 1 && out[0]->Deadline() == 40);
+    assert(sched.Empty());
+    assert(sched.Pop(admit_all) == nullptr);
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_weights();
+    test_no_starvation();
+    test_caps();
+    test_admission();
+    test_push_front();
+    test_expire();
+    return 0;
+}
@@ -0,0 +1,98 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <algorithm>
+#include <libmill.h>
+#include "Tenants.h"
+
+// Above this number of tenants, the idle ones are forgotten
+static constexpr size_t max_idle_tenants = 4096;
+
+TokenBucket::TokenBucket(uint64_t rate) noexcept:
+        rate_{rate / 1000.0}, capacity_{static_cast<double>(rate)},
+        tokens_{static_cast<double>(rate)}, last_{0} { }
+
+void TokenBucket::refill(int64_t now) noexcept {
+    if (now > last_) {
+        tokens_ = std::min(capacity_, tokens_ + (now - last_) * rate_);
+        last_ = now;
+    }
+}
+
+bool TokenBucket::IsFull(int64_t now) noexcept {
+    if (rate_ <= 0)
+        return true;
+    refill(now);
+    return tokens_ >= capacity_;
+}
+
+int64_t TokenBucket::Take(uint64_t n, int64_t now, int64_t max_dl) noexcept {
+    if (rate_ <= 0)
+        return now;
+    refill(now);
+    int64_t when = now;
+    const double after = tokens_ - n;
+    if (after < 0)
+        when += static_cast<int64_t>(-after / rate_) + 1;
+    if (when > max_dl)
+        return -1;
+    tokens_ = after;
+    return when;
+}
+
+Tenant::Tenant(const TenantLimits &l) noexcept:
+        limits_(l), ops_(l.ops_per_sec), bytes_(l.bytes_per_sec) { }
+
+bool Tenant::AdmitOp(int64_t max_wait) noexcept {
+    const auto now = mill_now();
+    const auto when = ops_.Take(1, now, now + max_wait);
+    if (when < 0)
+        return false;
+    if (when > now)
+        msleep(when);
+    return true;
+}
+
+void Tenant::AdmitBytes(uint64_t n) noexcept {
+    const auto now = mill_now();
+    const auto when = bytes_.Take(n, now, INT64_MAX);
+    if (when > now)
+        msleep(when);
+}
+
+bool Tenant::IsRested(int64_t now) noexcept {
+    return ops_.IsFull(now) && bytes_.IsFull(now);
+}
+
+TenantTable::TenantTable() noexcept: defaults_(), limits_(), tenants_() { }
+
+std::shared_ptr<Tenant> TenantTable::Get(const std::string &account,
+                                         const std::string &peer) noexcept {
+    auto itl = limits_.find(account);
+    const bool known = !account.empty() && itl != limits_.end();
+    // Distinct, even if an account looks like an address
+    const std::string id = known ? "account:" + account : "peer:" + peer;
+
+    auto it = tenants_.find(id);
+    if (it != tenants_.end())
+        return it->second;
+
+    if (tenants_.size() >= max_idle_tenants)
+        purge();
+    std::shared_ptr<Tenant> t(new Tenant(known ? itl->second : defaults_));
+    tenants_[id] = t;
+    return t;
+}
+
+void TenantTable::purge() noexcept {
+    const auto now = mill_now();
+    for (auto it = tenants_.begin(); it != tenants_.end();) {
+        if (it->second.use_count() == 1 && it->second->IsRested(now))
+            it = tenants_.erase(it);
+        else
+            ++it;
+    }
+}
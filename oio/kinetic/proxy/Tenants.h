@@ -0,0 +1,97 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_PROXY__TENANTS_H
+#define OIO_KINETIC_PROXY__TENANTS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+struct TenantLimits {
+    uint64_t ops_per_sec; // 0 for no limit
+    uint64_t bytes_per_sec; // 0 for no limit
+    bool background; // its exchanges yield to the others on the drives
+
+    TenantLimits() noexcept: ops_per_sec{0}, bytes_per_sec{0},
+                             background{false} { }
+};
+
+/* Refills `rate` tokens per second, up to one second of burst. The tokens
+ * may be borrowed, the next takers then wait for the debt to be paid. */
+class TokenBucket {
+  public:
+    TokenBucket(uint64_t rate) noexcept;
+
+    // Takes `n` tokens and returns when they are available, in ms. Nothing
+    // is taken if that is after `max_dl`, then -1 is returned.
+    int64_t Take(uint64_t n, int64_t now, int64_t max_dl) noexcept;
+
+    // Tells if nothing has been taken during the last second
+    bool IsFull(int64_t now) noexcept;
+
+  private:
+    void refill(int64_t now) noexcept;
+
+    double rate_; // per ms
+    double capacity_;
+    double tokens_;
+    int64_t last_;
+};
+
+class Tenant {
+  public:
+    Tenant(const TenantLimits &l) noexcept;
+
+    bool IsBackground() const noexcept { return limits_.background; }
+
+    // Waits for the start of a request. Returns false if the tenant has
+    // to wait for more than `max_wait` ms, the request is then refused.
+    bool AdmitOp(int64_t max_wait) noexcept;
+
+    // Waits for the right to transfer `n` bytes
+    void AdmitBytes(uint64_t n) noexcept;
+
+    // Tells if forgetting the tenant would give it nothing back
+    bool IsRested(int64_t now) noexcept;
+
+  private:
+    TenantLimits limits_;
+    TokenBucket ops_;
+    TokenBucket bytes_;
+};
+
+/* The tenants known by the proxy, identified by their account when it is
+ * configured, else by their address. Each tenant has its own buckets, so
+ * that a busy one only consumes its own share. */
+class TenantTable {
+  public:
+    TenantTable() noexcept;
+
+    // Limits of the tenants without specific ones
+    void DefaultLimits(const TenantLimits &l) noexcept { defaults_ = l; }
+
+    void AccountLimits(const std::string &account,
+                       const TenantLimits &l) noexcept {
+        limits_[account] = l;
+    }
+
+    // An account unknown to the configuration could be made up for each
+    // request: the tenant is then the peer address.
+    std::shared_ptr<Tenant> Get(const std::string &account,
+                                const std::string &peer) noexcept;
+
+  private:
+    // Forgets the tenants without request in progress nor debt
+    void purge() noexcept;
+
+    TenantLimits defaults_;
+    std::map<std::string, TenantLimits> limits_;
+    std::map<std::string, std::shared_ptr<Tenant>> tenants_;
+};
+
+#endif //OIO_KINETIC_PROXY__TENANTS_H
@@ -0,0 +1,123 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <glog/logging.h>
+
+#include <utils/utils.h>
+#include "Tenants.h"
+
+static void test_unlimited() noexcept {
+    TokenBucket tb(0);
+    for (int64_t now = 0; now < 100; ++now)
+        assert(tb.Take(1000000, now, now) == now);
+    assert(tb.IsFull(100));
+}
+
+static void test_burst_then_rate() noexcept {
+    const int64_t t0 = 100000;
+    TokenBucket tb(1000); // per second, 1 per ms
+    assert(tb.IsFull(t0));
+
+    // One second of burst at once
+    assert(tb.Take(1000, t0, t0) == t0);
+    assert(!tb.IsFull(t0));
+
+    // Then the pace of the refill
+    const auto next = tb.Take(1, t0, INT64_MAX);
+    assert(next > t0 && next <= t0 + 2);
+
+    // Nothing taken beyond the deadline
+    assert(tb.Take(100, t0, t0 + 50) == -1);
+    const auto later = tb.Take(10, t0, INT64_MAX);
+    assert(later > next && later <= t0 + 12);
+
+    // The debt paid, the bucket refills up to one second, not beyond
+    assert(!tb.IsFull(t0 + 500));
+    assert(tb.IsFull(t0 + 2000));
+    assert(tb.IsFull(t0 + 100000));
+    assert(tb.Take(1000, t0 + 100000, t0 + 100000) == t0 + 100000);
+    assert(tb.Take(1, t0 + 100000, t0 + 100000) == -1);
+}
+
+// Over a long period, the tokens taken are the rate plus the burst
+static void test_sustained() noexcept {
+    const int64_t t0 = 100000;
+    TokenBucket tb(500);
+    uint64_t taken = 0;
+    for (int64_t now = t0; now < t0 + 10000; ++now) {
+        while (tb.Take(1, now, now) == now)
+            ++taken;
+    }
+    assert(taken >= 500 + 500 * 10 - 5);
+    assert(taken <= 500 + 500 * 10 + 5);
+}
+
+static void test_identities() noexcept {
+    TenantTable table;
+    TenantLimits limited;
+    limited.ops_per_sec = 10;
+    limited.background = true;
+    table.AccountLimits("acct", limited);
+
+    // A configured account is the same tenant from anywhere
+    auto a1 = table.Get("acct", "10.0.0.1");
+    auto a2 = table.Get("acct", "10.0.0.2");
+    assert(a1 == a2);
+    assert(a1->IsBackground());
+
+    // Any other account is the peer
+    auto p1 = table.Get("", "10.0.0.1");
+    auto p2 = table.Get("made-up", "10.0.0.1");
+    auto p3 = table.Get("other", "10.0.0.1");
+    assert(p1 == p2 && p2 == p3);
+    assert(p1 != a1);
+    assert(!p1->IsBackground());
+    assert(table.Get("", "10.0.0.2") != p1);
+
+    // An account named as an address is not that address
+    table.AccountLimits("10.0.0.3", limited);
+    assert(table.Get("10.0.0.3", "10.0.0.4") != table.Get("", "10.0.0.3"));
+}
+
+// Once there are too many of them, the idle tenants are forgotten, but not
+// those in use nor those with a debt.
+static void test_purge() noexcept {
+    TenantTable table;
+    TenantLimits limited;
+    limited.ops_per_sec = 1;
+    table.AccountLimits("busy", limited);
+
+    auto busy = table.Get("busy", "");
+    assert(busy->AdmitOp(0));
+    std::weak_ptr<Tenant> indebted(busy);
+    busy.reset();
+
+    auto held = table.Get("", "held");
+    std::weak_ptr<Tenant> idle(table.Get("", "idle"));
+    for (int i = 0; i < 5000; ++i)
+        (void) table.Get("", "peer-" + std::to_string(i));
+
+    assert(idle.expired());
+    assert(!indebted.expired());
+    assert(table.Get("", "held") == held);
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_unlimited();
+    test_burst_then_rate();
+    test_sustained();
+    test_identities();
+    test_purge();
+    return 0;
+}
@@ -24,6 +24,7 @@ enum http_header_e
 	HDR_USERAGENT,
 
     HDR_OIO_TARGET,
+    HDR_OIO_ACCOUNT,
 	HDR_OIO_XATTR,
 };
 
@@ -29,6 +29,7 @@ parse_header := |*
     /accept/i           { return HDR_ACCEPT; };
     /user-agent/i       { return HDR_USERAGENT; };
     /X-oio-target/i     { return HDR_OIO_TARGET; };
+    /X-oio-account/i    { return HDR_OIO_ACCOUNT; };
     /X-oio-meta-.*/i    { return HDR_OIO_XATTR; };
 *|;
 }%%
@@ -58,6 +59,7 @@ const char * header_to_string (enum http_header_e h) {
 		ON_HEADER(HDR_,ACCEPT);
 		ON_HEADER(HDR_,USERAGENT);
         ON_HEADER(HDR_,OIO_TARGET);
+        ON_HEADER(HDR_,OIO_ACCOUNT);
         ON_HEADER(HDR_,OIO_XATTR);
 		default:
 			return "unmanaged";
@@ -10,8 +10,10 @@
 #include <sstream>
 #include <fstream>
 #include <iomanip>
+#include <map>
 
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <signal.h>
 
 #include <glog/logging.h>
@@ -23,6 +25,8 @@
 #include <http-parser/http_parser.h>
 #include <utils/utils.h>
 #include <utils/MillSocket.h>
+#include <utils/BufferPool.h>
+#include <utils/MemoryBudget.h>
 #include <oio/api/Upload.h>
 #include <oio/api/Download.h>
 #include <oio/api/Removal.h>
@@ -32,6 +36,7 @@
 #include <oio/kinetic/blob/Removal.h>
 
 #include "headers.h"
+#include "Tenants.h"
 
 using oio::blob::Upload;
 using oio::blob::Download;
@@ -42,12 +47,35 @@ using oio::kinetic::blob::DownloadBuilder;
 using oio::kinetic::blob::UploadBuilder;
 using oio::kinetic::client::ClientFactory;
 using oio::kinetic::client::CoroutineClientFactory;
+using oio::kinetic::client::Credentials;
+using oio::kinetic::client::SchedulerConfig;
 
 static volatile unsigned int flag_running = 1;
+static volatile unsigned int flag_stats = 0;
 
 static std::vector<MillSocket> SRV;
 static std::shared_ptr<ClientFactory> factory;
 
+// Number of connections opened to each drive
+static unsigned int drive_connections = 2;
+
+// Bytes of an upload sent to the drives but not acknowledged yet
+static uint64_t upload_window = 8 * 1024 * 1024;
+
+// Bytes of payload held by all the transfers, 0 for no limit
+static uint64_t memory_budget = 1024 * 1024 * 1024;
+
+// Credentials presented to the drives, by default and per drive
+static Credentials drive_default_credentials;
+static std::map<std::string, Credentials> drive_credentials;
+
+// Sharing of each drive connection between the classes of requests
+static SchedulerConfig drive_scheduling;
+
+// Shares of the clients, and how long a request may wait for its turn
+static TenantTable tenants;
+static int64_t tenant_max_wait = 1000;
+
 /* ------------------------------------------------------------------------- */
 
 struct RequestContext;
@@ -68,6 +96,8 @@ static int _on_message_complete_DOWNLOAD(http_parser *p);
 
 static int _on_message_complete_UPLOAD(http_parser *p);
 
+static int _on_message_complete_DIRECT(http_parser *p);
+
 static int _on_body_UPLOAD(http_parser *p, const char *b, size_t l);
 
 static int _on_chunk_header_UPLOAD(http_parser *p);
@@ -175,9 +205,15 @@ struct CnxContext {
     struct http_parser *parser;
     struct http_parser_settings settings;
 
+    // Tenant of the requests without account
+    std::string peer;
+
     // Related to the current request
     std::string chunk_id;
     std::vector<std::string> targets;
+    std::string account;
+    std::shared_ptr<Tenant> tenant;
+    uint64_t direct_body; // bytes of body to read without the parser
 
     SoftError defered_error;
     std::unique_ptr<Upload> upload;
@@ -192,7 +228,8 @@ struct CnxContext {
     ~CnxContext() noexcept { }
 
     CnxContext(MillSocket *c, http_parser *p) noexcept:
-            cnx{c}, parser{p}, settings(), chunk_id(), targets(),
+            cnx{c}, parser{p}, settings(), peer(), chunk_id(), targets(),
+            account(), tenant(), direct_body{0},
             upload{nullptr}, download{nullptr},
             last_field{HDR_none_matched}, last_field_name(),
             xattrs(), expect_100{false} { }
@@ -207,6 +244,9 @@ struct CnxContext {
         last_field = HDR_none_matched;
         chunk_id.clear();
         targets.clear();
+        account.clear();
+        tenant.reset();
+        direct_body = 0;
         defered_error.reset();
         upload.reset(nullptr);
         download.reset(nullptr);
@@ -305,6 +345,8 @@ int _on_headers_complete_UPLOAD(http_parser *p) {
     // Get an upload obect
     auto builder = UploadBuilder(factory);
     builder.BlockSize(512 * 1024);
+    builder.WindowSize(upload_window);
+    builder.Background(ctx->tenant->IsBackground());
     builder.Name(ctx->chunk_id);
     for (const auto &to: ctx->targets)
         builder.Target(to);
@@ -315,6 +357,14 @@ int _on_headers_complete_UPLOAD(http_parser *p) {
         case oio::blob::Upload::Status::OK:
             for (const auto &e: ctx->xattrs)
                 ctx->upload->SetXattr(e.first, e.second);
+            // A body of known length is read straight into the blocks. The
+            // parser is told there is no body, then paused at its end.
+            if (!(p->flags & F_CHUNKED) && p->content_length > 0
+                && p->content_length != std::numeric_limits<uint64_t>::max()) {
+                ctx->direct_body = p->content_length;
+                ctx->settings.on_message_complete = _on_message_complete_DIRECT;
+                return 1;
+            }
             return 0;
         case oio::blob::Upload::Status::Already:
             ctx->reply_error({406, 421, "blobs found"});
@@ -338,6 +388,7 @@ int _on_body_UPLOAD(http_parser *p, const char *buf, size_t len) {
     }
 
     auto ctx = (CnxContext *) p->data;
+    ctx->tenant->AdmitBytes(len);
     ctx->upload->Write(reinterpret_cast<const uint8_t *>(buf), len);
     return 0;
 }
@@ -353,6 +404,22 @@ int _on_chunk_complete_UPLOAD(http_parser *p UNUSED) {
     return 0;
 }
 
+int _on_message_complete_DIRECT(http_parser *p) {
+    http_parser_pause(p, 1);
+    return 0;
+}
+
+// Accounts `len` bytes of body already given to the upload
+static void _on_direct_body_UPLOAD(CnxContext *ctx, uint64_t len) noexcept {
+    assert(len <= ctx->direct_body);
+    ctx->tenant->AdmitBytes(len);
+    ctx->direct_body -= len;
+    if (ctx->direct_body == 0) {
+        ctx->settings.on_message_complete = _on_message_complete_UPLOAD;
+        _on_message_complete_UPLOAD(ctx->parser);
+    }
+}
+
 int _on_message_complete_UPLOAD(http_parser *p) {
     auto ctx = (CnxContext *) p->data;
     auto upload_rc = ctx->upload->Commit();
@@ -372,6 +439,7 @@ int _on_headers_complete_DOWNLOAD(http_parser *p) {
     CnxContext *ctx = (CnxContext *) p->data;
 
     DownloadBuilder builder(factory);
+    builder.Background(ctx->tenant->IsBackground());
     builder.Name(ctx->chunk_id);
     for (const auto t: ctx->targets)
         builder.Target(t);
@@ -403,8 +471,11 @@ int _on_message_complete_DOWNLOAD(http_parser *p UNUSED) {
 
     while (!ctx->download->IsEof()) {
         std::vector<uint8_t> buf;
-        ctx->download->Read(buf);
+        // Without the last chunk, the client sees a truncated stream
+        if (ctx->download->Read(buf) < 0)
+            return 1;
         if (buf.size() > 0) {
+            ctx->tenant->AdmitBytes(buf.size());
             std::stringstream ss;
             ss << std::hex << buf.size() << "\r\n";
             auto hdr = ss.str();
@@ -415,6 +486,7 @@ int _on_message_complete_DOWNLOAD(http_parser *p UNUSED) {
             };
             ctx->cnx->send(iov, 3, mill_now() + 1000);
         }
+        BufferPool::Default().Release(buf);
     }
 
     ctx->reply_end_of_stream();
@@ -536,6 +608,8 @@ int _on_header_value_COMMON(http_parser *p, const char *buf, size_t len) {
     assert(ctx->defered_error.http == 0);
     if (ctx->last_field == HDR_OIO_TARGET)
         ctx->targets.emplace_back(buf, len);
+    else if (ctx->last_field == HDR_OIO_ACCOUNT)
+        ctx->account.assign(buf, len);
     else if (ctx->last_field == HDR_OIO_XATTR) {
         if (p->method == HTTP_PUT) {
             ctx->xattrs[ctx->last_field_name] = std::move(std::string(buf, len));
@@ -572,6 +646,14 @@ int _on_headers_complete_COMMON(http_parser *p) {
         return 1;
     }
 
+    // Wait for the turn of the tenant, within reason
+    ctx->tenant = tenants.Get(ctx->account, ctx->peer);
+    if (!ctx->tenant->AdmitOp(tenant_max_wait)) {
+        ctx->reply_error({429, 429, "Too many requests"});
+        ctx->settings = default_settings;
+        return 1;
+    }
+
     if (p->method == HTTP_PUT) {
         ctx->settings = upload_settings;
         return _on_headers_complete_UPLOAD(p);
@@ -589,6 +671,21 @@ int _on_headers_complete_COMMON(http_parser *p) {
 
 /* -------------------------------------------------------------------------- */
 
+static std::string peer_address(int fd) noexcept {
+    struct sockaddr_storage ss;
+    socklen_t sslen = sizeof(ss);
+    char str[INET6_ADDRSTRLEN] = "";
+    if (0 != ::getpeername(fd, reinterpret_cast<struct sockaddr *>(&ss), &sslen))
+        return std::string();
+    if (ss.ss_family == AF_INET)
+        ::inet_ntop(AF_INET, &reinterpret_cast<struct sockaddr_in *>(&ss)->sin_addr,
+                    str, sizeof(str));
+    else if (ss.ss_family == AF_INET6)
+        ::inet_ntop(AF_INET6, &reinterpret_cast<struct sockaddr_in6 *>(&ss)->sin6_addr,
+                    str, sizeof(str));
+    return std::string(str);
+}
+
 /* copy the whole structure on the stack */
 coroutine static void task_client(MillSocket *sock) noexcept {
 
@@ -599,6 +696,7 @@ coroutine static void task_client(MillSocket *sock) noexcept {
     http_parser_init(&parser, HTTP_REQUEST);
     CnxContext cnx(front.get(), &parser);
     parser.data = &cnx;
+    cnx.peer = peer_address(front->fileno());
     cnx.settings = default_settings;
 
     std::vector<uint8_t> buffer(8192);
@@ -625,6 +723,16 @@ coroutine static void task_client(MillSocket *sock) noexcept {
                         &parser, &(cnx.settings),
                         reinterpret_cast<const char *>(buffer.data() + done),
                         sr - done);
+                if (parser.http_errno == HPE_PAUSED) {
+                    // The head of the body came with the headers
+                    done += consumed;
+                    const auto len = std::min<uint64_t>(cnx.direct_body, sr - done);
+                    cnx.upload->Write(buffer.data() + done, len);
+                    done += len;
+                    _on_direct_body_UPLOAD(&cnx, len);
+                    http_parser_pause(&parser, 0);
+                    continue;
+                }
                 if (parser.http_errno != 0) {
                     DLOG(INFO)
                     << "HTTP parsing error "
@@ -637,6 +745,20 @@ coroutine static void task_client(MillSocket *sock) noexcept {
                     done += consumed;
             }
         }
+
+        // Then the rest of the body, without copy
+        while (flag_running && cnx.direct_body > 0) {
+            uint32_t len = 0;
+            auto dst = cnx.upload->Reserve(
+                    std::min<uint64_t>(cnx.direct_body, UINT32_MAX), len);
+            errno = EAGAIN;
+            sr = front->read(dst, len, mill_now() + 1000);
+            cnx.upload->Written(sr > 0 ? sr : 0);
+            if (sr > 0)
+                _on_direct_body_UPLOAD(&cnx, sr);
+            else if (sr == -2 || errno != EAGAIN)
+                goto out;
+        }
     }
     out:
 
@@ -644,11 +766,25 @@ coroutine static void task_client(MillSocket *sock) noexcept {
     front->close();
 }
 
+static void _log_stats() noexcept {
+    const auto st = BufferPool::Default().Stats();
+    LOG(INFO) << "POOL hits=" << st.hits << " misses=" << st.misses
+              << " released=" << st.released << " dropped=" << st.dropped
+              << " pooled=" << st.pooled_bytes
+              << " budget=" << MemoryBudget::Default().Used()
+              << "/" << MemoryBudget::Default().Limit();
+}
+
 coroutine static void task_server(MillSocket &srv, chan out) noexcept {
     volatile bool input_ready = 1;
 
     while (flag_running) {
 
+        if (flag_stats) {
+            flag_stats = 0;
+            _log_stats();
+        }
+
         /* poll a client and fire a coroutine */
         if (input_ready) {
             MillSocket cli;
@@ -671,10 +807,99 @@ static void _sighandler_stop(int s UNUSED) noexcept {
     flag_running = 0;
 }
 
+static void _sighandler_stats(int s UNUSED) noexcept {
+    flag_stats = 1;
+}
+
 static void _spawn_server(MillSocket &srv, chan out) noexcept {
     mill_go(task_server(srv, out));
 }
 
+static bool load_credentials_json(const rapidjson::Value &v,
+                                  Credentials &creds) noexcept {
+    if (v.HasMember("identity")) {
+        if (!v["identity"].IsInt64())
+            return false;
+        creds.identity = v["identity"].GetInt64();
+    }
+    if (v.HasMember("key")) {
+        if (!v["key"].IsString())
+            return false;
+        creds.key.assign(v["key"].GetString(), v["key"].GetStringLength());
+    }
+    return true;
+}
+
+static bool load_scheduling_json(const rapidjson::Value &v,
+                                 SchedulerConfig &cfg) noexcept {
+    static const char *names[] = {"small_reads", "large_reads", "writes",
+                                  "background"};
+    for (unsigned int i = 0; i < oio::kinetic::client::nb_request_classes; ++i) {
+        if (!v.HasMember(names[i]))
+            continue;
+        const auto &c = v[names[i]];
+        if (!c.IsObject())
+            return false;
+        if (c.HasMember("weight")) {
+            if (!c["weight"].IsUint() || c["weight"].GetUint() < 1)
+                return false;
+            cfg.weights[i] = c["weight"].GetUint();
+        }
+        if (c.HasMember("max_inflight_bytes")) {
+            if (!c["max_inflight_bytes"].IsUint64())
+                return false;
+            cfg.caps[i] = c["max_inflight_bytes"].GetUint64();
+        }
+    }
+    return true;
+}
+
+static bool load_tenant_json(const rapidjson::Value &v,
+                             TenantLimits &limits) noexcept {
+    if (v.HasMember("ops_per_sec")) {
+        if (!v["ops_per_sec"].IsUint64())
+            return false;
+        limits.ops_per_sec = v["ops_per_sec"].GetUint64();
+    }
+    if (v.HasMember("bytes_per_sec")) {
+        if (!v["bytes_per_sec"].IsUint64())
+            return false;
+        limits.bytes_per_sec = v["bytes_per_sec"].GetUint64();
+    }
+    if (v.HasMember("background")) {
+        if (!v["background"].IsBool())
+            return false;
+        limits.background = v["background"].GetBool();
+    }
+    return true;
+}
+
+static bool load_tenants_json(const rapidjson::Value &v) noexcept {
+    if (v.HasMember("max_wait")) {
+        if (!v["max_wait"].IsUint())
+            return false;
+        tenant_max_wait = v["max_wait"].GetUint();
+    }
+    TenantLimits defaults;
+    if (v.HasMember("default")) {
+        if (!v["default"].IsObject() || !load_tenant_json(v["default"], defaults))
+            return false;
+        tenants.DefaultLimits(defaults);
+    }
+    if (v.HasMember("accounts")) {
+        const auto &accounts = v["accounts"];
+        if (!accounts.IsObject())
+            return false;
+        for (auto it = accounts.MemberBegin(); it != accounts.MemberEnd(); ++it) {
+            TenantLimits limits(defaults);
+            if (!it->value.IsObject() || !load_tenant_json(it->value, limits))
+                return false;
+            tenants.AccountLimits(it->name.GetString(), limits);
+        }
+    }
+    return true;
+}
+
 static bool load_configuration_json(rapidjson::Document &doc) noexcept {
     if (doc.HasMember("bind")) {
         if (doc["bind"].IsArray()) {
@@ -688,6 +913,68 @@ static bool load_configuration_json(rapidjson::Document &doc) noexcept {
         }
     }
 
+    if (doc.HasMember("drive_connections")) {
+        const auto &v = doc["drive_connections"];
+        if (!v.IsUint() || v.GetUint() < 1)
+            return false;
+        drive_connections = v.GetUint();
+    }
+
+    if (doc.HasMember("upload_window")) {
+        const auto &v = doc["upload_window"];
+        if (!v.IsUint64())
+            return false;
+        upload_window = v.GetUint64();
+    }
+
+    if (doc.HasMember("memory_budget")) {
+        const auto &v = doc["memory_budget"];
+        if (!v.IsUint64())
+            return false;
+        memory_budget = v.GetUint64();
+    }
+
+    if (doc.HasMember("buffer_pool")) {
+        const auto &v = doc["buffer_pool"];
+        if (!v.IsObject() || !v.HasMember("low") || !v["low"].IsUint64()
+            || !v.HasMember("high") || !v["high"].IsUint64())
+            return false;
+        BufferPool::Default().SetWatermarks(v["low"].GetUint64(),
+                                            v["high"].GetUint64());
+    }
+
+    if (doc.HasMember("credentials")) {
+        const auto &v = doc["credentials"];
+        if (!v.IsObject() || !load_credentials_json(v, drive_default_credentials))
+            return false;
+    }
+
+    if (doc.HasMember("scheduler")) {
+        const auto &v = doc["scheduler"];
+        if (!v.IsObject() || !load_scheduling_json(v, drive_scheduling))
+            return false;
+    }
+
+    if (doc.HasMember("tenants")) {
+        const auto &v = doc["tenants"];
+        if (!v.IsObject() || !load_tenants_json(v))
+            return false;
+    }
+
+    if (doc.HasMember("drives")) {
+        const auto &drives = doc["drives"];
+        if (!drives.IsObject())
+            return false;
+        for (auto it = drives.MemberBegin(); it != drives.MemberEnd(); ++it) {
+            if (!it->value.IsObject())
+                return false;
+            Credentials creds(drive_default_credentials);
+            if (!load_credentials_json(it->value, creds))
+                return false;
+            drive_credentials[it->name.GetString()] = creds;
+        }
+    }
+
     return true;
 }
 
@@ -713,7 +1000,7 @@ int main(int argc, char **argv) noexcept {
 
     signal(SIGINT, _sighandler_stop);
     signal(SIGTERM, _sighandler_stop);
-    signal(SIGUSR1, SIG_IGN);
+    signal(SIGUSR1, _sighandler_stats);
     signal(SIGUSR2, SIG_IGN);
     signal(SIGHUP, SIG_IGN);
     signal(SIGPIPE, SIG_IGN);
@@ -725,7 +1012,13 @@ int main(int argc, char **argv) noexcept {
     for (int i = 1; i < argc; ++i)
         load_configuration(argv[i]);
 
-    factory.reset(new CoroutineClientFactory);
+    auto cf = new CoroutineClientFactory(drive_connections);
+    cf->DefaultCredentials(drive_default_credentials);
+    for (const auto &e: drive_credentials)
+        cf->DriveCredentials(e.first, e.second);
+    cf->Scheduling(drive_scheduling);
+    factory.reset(cf);
+    MemoryBudget::Default().SetLimit(memory_budget);
 
     chan out = chmake(int, 0);
 
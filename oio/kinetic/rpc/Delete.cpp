@@ -13,8 +13,8 @@ namespace proto = ::com::seagate::kinetic::proto;
 using oio::kinetic::rpc::Request;
 using oio::kinetic::rpc::Delete;
 
-Delete::Delete() noexcept: req_(), status_{false} {
-    req_.reset(new Request);
+Delete::Delete() noexcept: req_(), status_{false}, not_found_{false} {
+    req_ = NewRequest();
     auto h = req_->cmd.mutable_header();
     h->set_messagetype(proto::Command_MessageType_DELETE);
     auto kv = req_->cmd.mutable_body()->mutable_keyvalue();
@@ -36,6 +36,7 @@ std::shared_ptr<Request> Delete::MakeRequest() noexcept {
 void Delete::ManageReply(Request &rep) noexcept {
     const auto code = rep.cmd.status().code();
     status_ = code == proto::Command_Status_StatusCode_SUCCESS;
+    not_found_ = code == proto::Command_Status_StatusCode_NOT_FOUND;
 }
 
 void Delete::Key (const char *k) noexcept {
@@ -28,6 +28,9 @@ class Delete : public oio::kinetic::rpc::Exchange {
 
     bool Ok() const noexcept { return status_; }
 
+    // The key was already absent
+    bool NotFound() const noexcept { return not_found_; }
+
     void Key (const char *k) noexcept;
 
     void Key (const std::string &k) noexcept;
@@ -35,6 +38,7 @@ class Delete : public oio::kinetic::rpc::Exchange {
   private:
     std::shared_ptr<oio::kinetic::rpc::Request> req_;
     bool status_;
+    bool not_found_;
 };
 
 }
@@ -18,6 +18,27 @@ namespace rpc {
 /* Represents any RPC to a kinetic drive */
 class Exchange {
   public:
+    Exchange() noexcept:
+            priority_{::com::seagate::kinetic::proto::Command_Priority_NORMAL},
+            deadline_{0} { }
+
+    virtual ~Exchange() { }
+
+    // Priority of the command on the drive
+    void SetPriority(::com::seagate::kinetic::proto::Command_Priority p) noexcept {
+        priority_ = p;
+    }
+
+    ::com::seagate::kinetic::proto::Command_Priority Priority() const noexcept {
+        return priority_;
+    }
+
+    // Absolute deadline for the reply (as mill_now()). With 0, the client
+    // derives the deadline from the latencies observed on the drive.
+    void SetDeadline(int64_t dl) noexcept { deadline_ = dl; }
+
+    int64_t Deadline() const noexcept { return deadline_; }
+
     virtual void SetSequence(int64_t s) noexcept = 0;
 
     virtual std::shared_ptr<oio::kinetic::rpc::Request> MakeRequest() noexcept = 0;
@@ -25,6 +46,10 @@ class Exchange {
     virtual void ManageReply(oio::kinetic::rpc::Request &rep) noexcept = 0;
 
     virtual bool Ok() const noexcept = 0;
+
+  private:
+    ::com::seagate::kinetic::proto::Command_Priority priority_;
+    int64_t deadline_;
 };
 
 } // namespace rpc
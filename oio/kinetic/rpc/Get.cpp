@@ -5,6 +5,7 @@
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
 #include <glog/logging.h>
+#include <utils/BufferPool.h>
 #include <oio/kinetic/client/ClientInterface.h>
 #include "Get.h"
 
@@ -13,14 +14,16 @@ using namespace oio::kinetic::rpc;
 namespace proto = ::com::seagate::kinetic::proto;
 
 Get::Get() noexcept: req_(), val_(), status_{false} {
-    req_.reset(new Request);
+    req_ = NewRequest();
     auto h = req_->cmd.mutable_header();
     h->set_messagetype(proto::Command_MessageType_GET);
     auto kv = req_->cmd.mutable_body()->mutable_keyvalue();
     kv->set_algorithm(proto::Command_Algorithm_SHA1);
 }
 
-Get::~Get() { }
+Get::~Get() {
+    BufferPool::Default().Release(val_);
+}
 
 void Get::SetSequence(int64_t s) noexcept {
     req_->cmd.mutable_header()->set_sequence(s);
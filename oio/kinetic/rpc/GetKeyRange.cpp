@@ -12,7 +12,7 @@ using oio::kinetic::rpc::Request;
 using oio::kinetic::rpc::GetKeyRange;
 
 GetKeyRange::GetKeyRange() noexcept: req_(), status_{false} {
-    req_.reset(new Request);
+    req_ = NewRequest();
     auto h = req_->cmd.mutable_header();
     h->set_messagetype(proto::Command_MessageType_GETKEYRANGE);
     auto r = req_->cmd.mutable_body()->mutable_range();
@@ -0,0 +1,41 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <kinetic.pb.h>
+#include "GetLog.h"
+
+namespace proto = ::com::seagate::kinetic::proto;
+using oio::kinetic::rpc::Request;
+using oio::kinetic::rpc::GetLog;
+
+GetLog::GetLog() noexcept: req_(), limits_(), status_{false} {
+    req_ = NewRequest();
+    auto h = req_->cmd.mutable_header();
+    h->set_messagetype(proto::Command_MessageType_GETLOG);
+    req_->cmd.mutable_body()->mutable_getlog();
+}
+
+GetLog::~GetLog() noexcept { }
+
+void GetLog::Type(proto::Command_GetLog_Type t) noexcept {
+    req_->cmd.mutable_body()->mutable_getlog()->add_types(t);
+}
+
+void GetLog::SetSequence(int64_t s) noexcept {
+    req_->cmd.mutable_header()->set_sequence(s);
+}
+
+std::shared_ptr<Request> GetLog::MakeRequest() noexcept {
+    assert(nullptr != req_.get());
+    return req_;
+}
+
+void GetLog::ManageReply(Request &rep) noexcept {
+    auto code = rep.cmd.status().code();
+    status_ = code == proto::Command_Status_StatusCode_SUCCESS;
+    if (status_ && rep.cmd.body().getlog().has_limits())
+        limits_.CopyFrom(rep.cmd.body().getlog().limits());
+}
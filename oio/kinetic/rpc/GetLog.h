@@ -0,0 +1,48 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_GETLOG_H
+#define OIO_KINETIC_GETLOG_H
+
+#include <cstdint>
+#include <memory>
+#include "Request.h"
+#include "Exchange.h"
+
+namespace oio {
+namespace kinetic {
+namespace rpc {
+
+class GetLog : public oio::kinetic::rpc::Exchange {
+  public:
+    GetLog() noexcept;
+
+    ~GetLog() noexcept;
+
+    void Type(::com::seagate::kinetic::proto::Command_GetLog_Type t) noexcept;
+
+    const ::com::seagate::kinetic::proto::Command_GetLog_Limits &
+    Limits() const noexcept { return limits_; }
+
+    void SetSequence(int64_t s) noexcept;
+
+    std::shared_ptr<oio::kinetic::rpc::Request> MakeRequest() noexcept;
+
+    void ManageReply(oio::kinetic::rpc::Request &rep) noexcept;
+
+    bool Ok() const noexcept { return status_; }
+
+  private:
+    std::shared_ptr<oio::kinetic::rpc::Request> req_;
+    ::com::seagate::kinetic::proto::Command_GetLog_Limits limits_;
+    bool status_;
+};
+
+} // namespace rpc
+} // namespace kinetic
+} // namespace oio
+
+#endif //OIO_KINETIC_GETLOG_H
@@ -10,7 +10,7 @@ using oio::kinetic::rpc::GetNext;
 namespace proto = ::com::seagate::kinetic::proto;
 
 GetNext::GetNext() noexcept: req_(), out_(), status_{false} {
-    req_.reset(new Request);
+    req_ = NewRequest();
     auto h = req_->cmd.mutable_header();
     h->set_messagetype(proto::Command_MessageType_GETNEXT);
     auto kv = req_->cmd.mutable_body()->mutable_keyvalue();
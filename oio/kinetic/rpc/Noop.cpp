@@ -0,0 +1,34 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <kinetic.pb.h>
+#include "Noop.h"
+
+namespace proto = ::com::seagate::kinetic::proto;
+using oio::kinetic::rpc::Request;
+using oio::kinetic::rpc::Noop;
+
+Noop::Noop() noexcept: req_(), status_{false} {
+    req_ = NewRequest();
+    req_->cmd.mutable_header()->set_messagetype(proto::Command_MessageType_NOOP);
+}
+
+Noop::~Noop() noexcept { }
+
+void Noop::SetSequence(int64_t s) noexcept {
+    req_->cmd.mutable_header()->set_sequence(s);
+}
+
+std::shared_ptr<Request> Noop::MakeRequest() noexcept {
+    assert(nullptr != req_.get());
+    return req_;
+}
+
+void Noop::ManageReply(Request &rep) noexcept {
+    auto code = rep.cmd.status().code();
+    status_ = code == proto::Command_Status_StatusCode_SUCCESS;
+}
@@ -14,8 +14,8 @@ using namespace oio::kinetic::client;
 using namespace oio::kinetic::rpc;
 namespace proto = ::com::seagate::kinetic::proto;
 
-Put::Put() noexcept: req_(nullptr) {
-    req_.reset(new Request);
+Put::Put() noexcept: req_(nullptr), status_{false} {
+    req_ = NewRequest();
     auto h = req_->cmd.mutable_header();
     h->set_messagetype(proto::Command_MessageType_PUT);
     auto kv = req_->cmd.mutable_body()->mutable_keyvalue();
@@ -0,0 +1,46 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <vector>
+#include <utils/BufferPool.h>
+#include <utils/PoolAllocator.h>
+#include "Request.h"
+
+using oio::kinetic::rpc::Request;
+
+// Bounds of what the pool keeps. The coroutines all run in the same thread,
+// the pool needs no lock.
+static constexpr size_t max_pooled = 1024;
+static constexpr size_t max_pooled_value = 64 * 1024;
+
+static std::vector<Request *> pool;
+
+static void recycle(Request *r) noexcept {
+    // The large values go to the pool of buffers
+    if (r->value.capacity() > max_pooled_value)
+        BufferPool::Default().Release(r->value);
+    if (pool.size() >= max_pooled) {
+        delete r;
+        return;
+    }
+    r->cmd.Clear();
+    r->msg.Clear();
+    r->value.clear();
+    pool.push_back(r);
+}
+
+std::shared_ptr<Request> oio::kinetic::rpc::NewRequest() noexcept {
+    Request *r;
+    if (pool.empty()) {
+        r = new Request;
+    } else {
+        r = pool.back();
+        pool.pop_back();
+    }
+    // The control block comes from a free list too. Not allocate_shared():
+    // it would destroy the messages, and their allocations with them.
+    return std::shared_ptr<Request>(r, recycle, PoolAllocator<Request>());
+}
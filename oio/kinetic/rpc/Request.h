@@ -8,6 +8,7 @@
 #define OIO_KINETIC_REQUEST_H
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <kinetic.pb.h>
 
@@ -29,6 +30,11 @@ struct Request {
     Request(Request &&o) noexcept = delete;
 };
 
+/* Returns an empty request, recycled from a previous exchange when possible.
+ * The messages are cleared but keep their allocations, so that building a
+ * similar request doesn't hit the allocator. */
+std::shared_ptr<Request> NewRequest() noexcept;
+
 } // namespace rpc
 } // namespace kinetic
 } // namespace oio
@@ -0,0 +1,90 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <algorithm>
+#include "BufferPool.h"
+
+static constexpr size_t default_low = 64 * 1024 * 1024;
+static constexpr size_t default_high = 128 * 1024 * 1024;
+
+static size_t _class_size(unsigned int i) noexcept {
+    return BufferPool::min_class_size << i;
+}
+
+BufferPool &BufferPool::Default() noexcept {
+    static BufferPool pool;
+    return pool;
+}
+
+BufferPool::BufferPool() noexcept:
+        classes_(), low_{default_low}, high_{default_high},
+        stats_{0, 0, 0, 0, 0} { }
+
+std::vector<uint8_t> BufferPool::Acquire(size_t size) noexcept {
+    std::vector<uint8_t> buf;
+    if (size < min_class_size / 2 || size > _class_size(nb_classes - 1)) {
+        buf.reserve(size);
+        return buf;
+    }
+
+    // The smallest class large enough
+    unsigned int i = 0;
+    while (_class_size(i) < size)
+        ++i;
+    auto &cl = classes_[i];
+    if (!cl.empty()) {
+        buf.swap(cl.back());
+        cl.pop_back();
+        stats_.pooled_bytes -= buf.capacity();
+        ++stats_.hits;
+    } else {
+        buf.reserve(_class_size(i));
+        ++stats_.misses;
+    }
+    return buf;
+}
+
+void BufferPool::Release(std::vector<uint8_t> &buf) noexcept {
+    const auto capacity = buf.capacity();
+    if (capacity < min_class_size) {
+        std::vector<uint8_t>().swap(buf);
+        ++stats_.dropped;
+        return;
+    }
+
+    // The largest class it may serve
+    unsigned int i = 0;
+    while (i + 1 < nb_classes && _class_size(i + 1) <= capacity)
+        ++i;
+    buf.clear();
+    classes_[i].emplace_back(std::move(buf));
+    std::vector<uint8_t>().swap(buf);
+    stats_.pooled_bytes += capacity;
+    ++stats_.released;
+    if (stats_.pooled_bytes > high_)
+        trim(low_);
+}
+
+void BufferPool::SetWatermarks(size_t low, size_t high) noexcept {
+    low_ = std::min(low, high);
+    high_ = high;
+    if (stats_.pooled_bytes > high_)
+        trim(low_);
+}
+
+void BufferPool::trim(size_t target) noexcept {
+    // The largest buffers go first, they are the least reused
+    for (unsigned int i = nb_classes; i > 0 && stats_.pooled_bytes > target;) {
+        auto &cl = classes_[i - 1];
+        if (cl.empty()) {
+            --i;
+            continue;
+        }
+        stats_.pooled_bytes -= cl.back().capacity();
+        cl.pop_back();
+        ++stats_.dropped;
+    }
+}
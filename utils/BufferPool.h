@@ -0,0 +1,61 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_UTILS_BUFFERPOOL_H
+#define OIO_KINETIC_UTILS_BUFFERPOOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct BufferPoolStats {
+    uint64_t hits; // buffers acquired from the pool
+    uint64_t misses; // buffers allocated
+    uint64_t released; // buffers kept for a later use
+    uint64_t dropped; // buffers freed, too small or beyond the watermark
+    size_t pooled_bytes;
+};
+
+/* Keeps the large buffers of the values (blocks, frames, chunks) for a later
+ * use, instead of a malloc() and its page faults for each of them. The
+ * buffers are sorted in classes of power of two capacities. Once the pool
+ * holds more than its high watermark, it is trimmed down to its low one.
+ * There is one pool per process, not protected against concurrent accesses:
+ * all the coroutines run in the same thread. */
+class BufferPool {
+  public:
+    static constexpr size_t min_class_size = 64 * 1024;
+    static constexpr unsigned int nb_classes = 9; // up to 16MiB
+
+    static BufferPool &Default() noexcept;
+
+    // Returns an empty buffer, with room for at least `size` bytes
+    std::vector<uint8_t> Acquire(size_t size) noexcept;
+
+    // Takes the allocation of `buf`, which is left empty
+    void Release(std::vector<uint8_t> &buf) noexcept;
+
+    void SetWatermarks(size_t low, size_t high) noexcept;
+
+    BufferPoolStats Stats() const noexcept { return stats_; }
+
+  private:
+    BufferPool() noexcept;
+
+    BufferPool(const BufferPool &o) = delete;
+
+    BufferPool(BufferPool &&o) = delete;
+
+    void trim(size_t target) noexcept;
+
+    std::array<std::vector<std::vector<uint8_t>>, nb_classes> classes_;
+    size_t low_;
+    size_t high_;
+    BufferPoolStats stats_;
+};
+
+#endif //OIO_KINETIC_UTILS_BUFFERPOOL_H
@@ -0,0 +1,116 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <netinet/in.h>
+#include <openssl/sha.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+#include "Hmac.h"
+
+static_assert(HmacSha1::digest_size == SHA_DIGEST_LENGTH, "SHA1 digest size");
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+
+// The HMAC_* functions are deprecated since OpenSSL 3
+HmacSha1::HmacSha1(const std::string &key) noexcept: ctx_{nullptr} {
+    EVP_MAC *mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    assert(mac != nullptr);
+    ctx_ = EVP_MAC_CTX_new(mac);
+    EVP_MAC_free(mac);
+    assert(ctx_ != nullptr);
+    char digest[] = "SHA1";
+    OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+            OSSL_PARAM_construct_end()
+    };
+    const auto rc = EVP_MAC_init(ctx_,
+                                 reinterpret_cast<const uint8_t *>(key.data()),
+                                 key.size(), params);
+    assert(rc == 1);
+    (void) rc;
+}
+
+HmacSha1::HmacSha1(const HmacSha1 &o) noexcept: ctx_{EVP_MAC_CTX_dup(o.ctx_)} {
+    assert(ctx_ != nullptr);
+}
+
+HmacSha1::~HmacSha1() noexcept {
+    EVP_MAC_CTX_free(ctx_);
+}
+
+void HmacSha1::Compute(const uint8_t *data, size_t len,
+                       uint8_t *out) noexcept {
+    // Without a key, back to the keyed state, the key isn't hashed again
+    EVP_MAC_init(ctx_, nullptr, 0, nullptr);
+    if (len > 0) {
+        uint32_t be = ::htonl(len);
+        EVP_MAC_update(ctx_, reinterpret_cast<unsigned char *>(&be), sizeof(be));
+        EVP_MAC_update(ctx_, data, len);
+    }
+    size_t outlen = 0;
+    EVP_MAC_final(ctx_, out, &outlen, digest_size);
+}
+
+#else
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+// OpenSSL 1.1 made the HMAC_CTX opaque, provide its allocators to 1.0
+static HMAC_CTX *HMAC_CTX_new(void) {
+    HMAC_CTX *ctx = new HMAC_CTX;
+    HMAC_CTX_init(ctx);
+    return ctx;
+}
+
+static void HMAC_CTX_free(HMAC_CTX *ctx) {
+    HMAC_CTX_cleanup(ctx);
+    delete ctx;
+}
+#endif
+
+HmacSha1::HmacSha1(const std::string &key) noexcept:
+        keyed_{HMAC_CTX_new()}, work_{HMAC_CTX_new()} {
+    assert(keyed_ != nullptr && work_ != nullptr);
+    HMAC_Init_ex(keyed_, key.data(), key.size(), EVP_sha1(), nullptr);
+}
+
+HmacSha1::HmacSha1(const HmacSha1 &o) noexcept:
+        keyed_{HMAC_CTX_new()}, work_{HMAC_CTX_new()} {
+    assert(keyed_ != nullptr && work_ != nullptr);
+    HMAC_CTX_copy(keyed_, o.keyed_);
+}
+
+HmacSha1::~HmacSha1() noexcept {
+    HMAC_CTX_free(work_);
+    HMAC_CTX_free(keyed_);
+}
+
+void HmacSha1::Compute(const uint8_t *data, size_t len,
+                       uint8_t *out) noexcept {
+    HMAC_CTX_copy(work_, keyed_);
+    if (len > 0) {
+        uint32_t be = ::htonl(len);
+        HMAC_Update(work_, reinterpret_cast<unsigned char *>(&be), sizeof(be));
+        HMAC_Update(work_, data, len);
+    }
+    unsigned int outlen = digest_size;
+    HMAC_Final(work_, out, &outlen);
+}
+
+#endif
+
+std::vector<uint8_t> HmacSha1::Compute(const std::string &val) noexcept {
+    std::vector<uint8_t> result(digest_size);
+    Compute(reinterpret_cast<const uint8_t *>(val.data()), val.size(),
+            result.data());
+    return result;
+}
@@ -0,0 +1,52 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_UTILS_HMAC_H
+#define OIO_KINETIC_UTILS_HMAC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <openssl/opensslv.h>
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+struct evp_mac_ctx_st;
+#else
+struct hmac_ctx_st;
+#endif
+
+/* SHA1-HMAC as expected by the Kinetic devices: the length of the payload is
+ * hashed (32 bits, big endian) before the payload itself. The key schedule is
+ * computed once. With OpenSSL 3, the MAC is reinitialized from it for each
+ * message, before, the keyed state is copied. */
+class HmacSha1 {
+  public:
+    static constexpr unsigned int digest_size = 20;
+
+    HmacSha1(const std::string &key) noexcept;
+
+    HmacSha1(const HmacSha1 &o) noexcept;
+
+    ~HmacSha1() noexcept;
+
+    void Compute(const uint8_t *data, size_t len, uint8_t *out) noexcept;
+
+    std::vector<uint8_t> Compute(const std::string &val) noexcept;
+
+  private:
+    HmacSha1() = delete;
+
+    HmacSha1 &operator=(const HmacSha1 &o) = delete;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    struct evp_mac_ctx_st *ctx_;
+#else
+    struct hmac_ctx_st *keyed_;
+    struct hmac_ctx_st *work_;
+#endif
+};
+
+#endif //OIO_KINETIC_UTILS_HMAC_H
@@ -0,0 +1,73 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <algorithm>
+#include <cassert>
+#include <libmill.h>
+#include "MemoryBudget.h"
+
+MemoryBudget &MemoryBudget::Default() noexcept {
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::MemoryBudget() noexcept: limit_{0}, used_{0}, waiters_() { }
+
+void MemoryBudget::SetLimit(uint64_t bytes) noexcept {
+    limit_ = bytes;
+    wake();
+}
+
+bool MemoryBudget::fits(uint64_t n) const noexcept {
+    return limit_ == 0 || used_ == 0 || used_ + n <= limit_;
+}
+
+bool MemoryBudget::TryAcquire(uint64_t n) noexcept {
+    // Don't pass the coroutines already waiting
+    if (!waiters_.empty() || !fits(n))
+        return false;
+    used_ += n;
+    return true;
+}
+
+bool MemoryBudget::Acquire(uint64_t n, int64_t dl) noexcept {
+    if (TryAcquire(n))
+        return true;
+
+    Waiter w{n, chmake(int, 1), false};
+    waiters_.push_back(&w);
+    mill_choose {
+        mill_in(w.ready, int, sig):
+            (void) sig;
+        mill_deadline(dl):
+            if (!w.granted) {
+                auto it = std::find(waiters_.begin(), waiters_.end(), &w);
+                assert(it != waiters_.end());
+                waiters_.erase(it);
+                // The next ones may fit now
+                wake();
+            }
+        mill_end
+    }
+    chclose(w.ready);
+    return w.granted;
+}
+
+void MemoryBudget::Release(uint64_t n) noexcept {
+    assert(n <= used_);
+    used_ -= n;
+    wake();
+}
+
+void MemoryBudget::wake() noexcept {
+    while (!waiters_.empty() && fits(waiters_.front()->bytes)) {
+        auto w = waiters_.front();
+        waiters_.pop_front();
+        used_ += w->bytes;
+        w->granted = true;
+        chs(w->ready, int, 0);
+    }
+}
@@ -0,0 +1,64 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_UTILS_MEMORYBUDGET_H
+#define OIO_KINETIC_UTILS_MEMORYBUDGET_H
+
+#include <cstdint>
+#include <deque>
+
+struct mill_chan;
+
+/* Bytes of payload the process may hold in memory, shared by all the
+ * transfers. A coroutine asking for more than what is left waits for the
+ * others to release theirs, in the order of the requests. A single request
+ * larger than the whole budget is granted once nothing else is held.
+ * There is one budget per process, not protected against concurrent
+ * accesses: all the coroutines run in the same thread. */
+class MemoryBudget {
+  public:
+    static MemoryBudget &Default() noexcept;
+
+    // 0 for no limit
+    void SetLimit(uint64_t bytes) noexcept;
+
+    // Waits until `n` bytes are granted, or until `dl` (-1 for no deadline).
+    // Returns false if the deadline expired.
+    bool Acquire(uint64_t n, int64_t dl) noexcept;
+
+    // Grants `n` bytes only if it needs no wait
+    bool TryAcquire(uint64_t n) noexcept;
+
+    void Release(uint64_t n) noexcept;
+
+    uint64_t Used() const noexcept { return used_; }
+
+    uint64_t Limit() const noexcept { return limit_; }
+
+  private:
+    struct Waiter {
+        uint64_t bytes;
+        struct mill_chan *ready; // <int>
+        bool granted;
+    };
+
+    MemoryBudget() noexcept;
+
+    MemoryBudget(const MemoryBudget &o) = delete;
+
+    MemoryBudget(MemoryBudget &&o) = delete;
+
+    bool fits(uint64_t n) const noexcept;
+
+    // Grants the waiters that fit, in their order
+    void wake() noexcept;
+
+    uint64_t limit_;
+    uint64_t used_;
+    std::deque<Waiter *> waiters_;
+};
+
+#endif //OIO_KINETIC_UTILS_MEMORYBUDGET_H
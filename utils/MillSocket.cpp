@@ -85,8 +85,11 @@ bool MillSocket::send (struct iovec *iov, unsigned int count, int64_t dl) noexce
                 auto evt = fdwait(sock_.fileno(), FDW_OUT, real_dl);
                 if (evt & FDW_ERR)
                     return false;
+                if (!evt)
+                    return false;
                 continue;
             }
+            return false;
         }
         if (rc > 0) {
             sent += rc;
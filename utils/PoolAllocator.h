@@ -0,0 +1,66 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OIO_KINETIC_UTILS_POOLALLOCATOR_H
+#define OIO_KINETIC_UTILS_POOLALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/* Allocator keeping the released single objects in a free list, for the
+ * objects allocated and freed at a high rate, e.g. with allocate_shared().
+ * There is one free list per type, not protected against concurrent
+ * accesses: all the coroutines run in the same thread. */
+template<typename T, size_t MaxFree = 1024>
+class PoolAllocator {
+  public:
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind { typedef PoolAllocator<U, MaxFree> other; };
+
+    PoolAllocator() noexcept { }
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U, MaxFree> &) noexcept { }
+
+    T *allocate(size_t n) {
+        auto &fl = free_list();
+        if (n == 1 && !fl.empty()) {
+            void *p = fl.back();
+            fl.pop_back();
+            return static_cast<T *>(p);
+        }
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        auto &fl = free_list();
+        if (n == 1 && fl.size() < MaxFree)
+            fl.push_back(p);
+        else
+            ::operator delete(p);
+    }
+
+  private:
+    static std::vector<void *> &free_list() noexcept {
+        static std::vector<void *> fl;
+        return fl;
+    }
+};
+
+template<typename T, typename U, size_t M>
+bool operator==(const PoolAllocator<T, M> &, const PoolAllocator<U, M> &) {
+    return true;
+}
+
+template<typename T, typename U, size_t M>
+bool operator!=(const PoolAllocator<T, M> &, const PoolAllocator<U, M> &) {
+    return false;
+}
+
+#endif //OIO_KINETIC_UTILS_POOLALLOCATOR_H
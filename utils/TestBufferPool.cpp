@@ -0,0 +1,128 @@
+/** Copyright 2016 Contributors (see the AUTHORS file)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, you can
+ * obtain one at https://mozilla.org/MPL/2.0/ */
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "utils.h"
+#include "BufferPool.h"
+
+static constexpr size_t KiB = 1024;
+static constexpr size_t MiB = 1024 * 1024;
+
+// Empties the pool, then restores the watermarks given
+static void reset(size_t low, size_t high) noexcept {
+    auto &pool = BufferPool::Default();
+    pool.SetWatermarks(0, 0);
+    pool.SetWatermarks(low, high);
+    assert(pool.Stats().pooled_bytes == 0);
+}
+
+static void test_classes() noexcept {
+    reset(64 * MiB, 128 * MiB);
+    auto &pool = BufferPool::Default();
+
+    // The capacity of the smallest class large enough
+    const size_t sizes[] = {32 * KiB, 64 * KiB, 64 * KiB + 1, 100 * KiB,
+                            512 * KiB, 3 * MiB, 16 * MiB};
+    const size_t classes[] = {64 * KiB, 64 * KiB, 128 * KiB, 128 * KiB,
+                              512 * KiB, 4 * MiB, 16 * MiB};
+    for (unsigned int i = 0; i < 7; ++i) {
+        const auto before = pool.Stats().misses;
+        auto buf = pool.Acquire(sizes[i]);
+        assert(buf.empty());
+        assert(buf.capacity() == classes[i]);
+        assert(pool.Stats().misses == before + 1);
+    }
+
+    // Out of the classes, a plain allocation
+    const auto before = pool.Stats();
+    auto small = pool.Acquire(1000);
+    assert(small.empty() && small.capacity() >= 1000);
+    auto huge = pool.Acquire(16 * MiB + 1);
+    assert(huge.capacity() >= 16 * MiB + 1);
+    assert(pool.Stats().misses == before.misses);
+    assert(pool.Stats().hits == before.hits);
+}
+
+static void test_reuse() noexcept {
+    reset(64 * MiB, 128 * MiB);
+    auto &pool = BufferPool::Default();
+
+    auto buf = pool.Acquire(512 * KiB);
+    buf.resize(1000, 'x');
+    const auto data = buf.data();
+    pool.Release(buf);
+    assert(buf.empty() && buf.capacity() == 0);
+    assert(pool.Stats().pooled_bytes == 512 * KiB);
+
+    // The same allocation, emptied
+    const auto hits = pool.Stats().hits;
+    auto again = pool.Acquire(300 * KiB);
+    assert(again.data() == data);
+    assert(again.empty() && again.capacity() == 512 * KiB);
+    assert(pool.Stats().hits == hits + 1);
+    assert(pool.Stats().pooled_bytes == 0);
+    pool.Release(again);
+
+    // A buffer serves the largest class it covers, not the ones above
+    std::vector<uint8_t> odd;
+    odd.reserve(100 * KiB);
+    pool.Release(odd);
+    auto larger = pool.Acquire(100 * KiB);
+    assert(larger.capacity() == 128 * KiB);
+    auto fits = pool.Acquire(64 * KiB);
+    assert(fits.capacity() >= 100 * KiB);
+
+    // Too small to be kept
+    const auto dropped = pool.Stats().dropped;
+    std::vector<uint8_t> tiny;
+    tiny.reserve(KiB);
+    pool.Release(tiny);
+    assert(pool.Stats().dropped == dropped + 1);
+    assert(tiny.capacity() == 0);
+}
+
+// Beyond the high watermark, down to the low one, the largest first
+static void test_trim() noexcept {
+    reset(256 * KiB, MiB);
+    auto &pool = BufferPool::Default();
+
+    std::vector<std::vector<uint8_t>> bufs;
+    for (int i = 0; i < 4; ++i)
+        bufs.push_back(pool.Acquire(64 * KiB));
+    bufs.push_back(pool.Acquire(MiB));
+    for (auto &b: bufs)
+        pool.Release(b);
+    assert(pool.Stats().pooled_bytes == 256 * KiB);
+
+    // The small ones are still there
+    for (int i = 0; i < 4; ++i)
+        assert(pool.Acquire(64 * KiB).capacity() == 64 * KiB);
+    assert(pool.Stats().pooled_bytes == 0);
+
+    // Lowering the watermarks trims at once
+    reset(64 * MiB, 128 * MiB);
+    auto a = pool.Acquire(4 * MiB);
+    auto b = pool.Acquire(64 * KiB);
+    pool.Release(a);
+    pool.Release(b);
+    pool.SetWatermarks(64 * KiB, 128 * KiB);
+    assert(pool.Stats().pooled_bytes == 64 * KiB);
+}
+
+int main(int argc UNUSED, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    test_classes();
+    test_reuse();
+    test_trim();
+    return 0;
+}
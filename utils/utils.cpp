@@ -5,11 +5,10 @@
  * obtain one at https://mozilla.org/MPL/2.0/ */
 
 #include <random>
-#include <netinet/in.h>
-#include <openssl/hmac.h>
 #include <openssl/sha.h>
 
 #include "utils.h"
+#include "Hmac.h"
 
 std::vector<uint8_t>
 compute_sha1 (const std::vector<uint8_t> &val) noexcept
@@ -24,24 +23,8 @@ compute_sha1 (const std::vector<uint8_t> &val) noexcept
 std::vector<uint8_t>
 compute_sha1_hmac (const std::string &key, const std::string &val) noexcept
 {
-    HMAC_CTX ctx;
-    HMAC_CTX_init(&ctx);
-    HMAC_Init_ex(&ctx, key.c_str(), key.length(), EVP_sha1(), NULL);
-
-    if (val.length() > 0) {
-        uint32_t be = ::htonl(val.length());
-        HMAC_Update(&ctx, reinterpret_cast<unsigned char *>(&be),
-                    sizeof(uint32_t));
-        HMAC_Update(&ctx, reinterpret_cast<const unsigned char *>(val.c_str()), val.length());
-    }
-
-    unsigned int len = SHA_DIGEST_LENGTH;
-    std::vector<uint8_t> result(len);
-
-    HMAC_Final(&ctx, result.data(), &len);
-    HMAC_CTX_cleanup(&ctx);
-
-    return result;
+    HmacSha1 hmac(key);
+    return hmac.Compute(val);
 }
 
 static std::random_device rand_dev;